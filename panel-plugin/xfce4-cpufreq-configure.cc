@@ -20,9 +20,11 @@
  *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <algorithm>
 #include <libxfce4ui/libxfce4ui.h>
 #include "xfce4-cpufreq-plugin.h"
 #include "xfce4-cpufreq-configure.h"
+#include "xfce4-cpufreq-utils.h"
 
 
 
@@ -52,6 +54,8 @@ update_sensitivity (const Ptr<CpuFreqPluginConfigure> &configure)
   }
 
   gtk_widget_set_sensitive (configure->icon_color_freq, options->show_icon);
+  gtk_widget_set_sensitive (configure->timeout_max_hbox, options->timeout_adaptive);
+  gtk_widget_set_sensitive (configure->cpu_set_hbox, options->show_cpu < 0);
 }
 
 
@@ -97,6 +101,23 @@ check_button_changed (GtkWidget *button, const Ptr<CpuFreqPluginConfigure> &conf
   else if (button == configure->one_line)
     options->one_line = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (button));
 
+  else if (button == configure->sample_isolated)
+    options->sample_isolated = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (button));
+
+  else if (button == configure->scope_affinity)
+  {
+    options->scope_affinity = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (button));
+    /* The affinity might have changed since it was read */
+    if (options->scope_affinity)
+      cpufreq_update_cpu_set ();
+  }
+
+  else if (button == configure->timeout_adaptive)
+  {
+    options->timeout_adaptive = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (button));
+    cpufreq_restart_timeout ();
+  }
+
   update_sensitivity (configure);
   validate_configuration (configure);
 
@@ -248,7 +269,10 @@ combo_changed (GtkComboBox *combo, const Ptr<CpuFreqPluginConfigure> &configure)
       options->show_cpu = CPU_AVG;
     else if (selected == num_cpus + 2)
       options->show_cpu = CPU_MAX;
+    else if (selected == num_cpus + 3)
+      options->show_cpu = CPU_MEDIAN;
 
+    update_sensitivity (configure);
     cpufreq_update_plugin (true);
   }
   else if (GTK_WIDGET (combo) == configure->combo_unit)
@@ -268,6 +292,50 @@ combo_changed (GtkComboBox *combo, const Ptr<CpuFreqPluginConfigure> &configure)
 
 
 
+/*
+ * Shows a warning icon in the entry if the CPU set can't be used,
+ * in which case the plugin falls back to all CPUs.
+ */
+static void
+entry_cpu_set_validate (GtkEntry *entry)
+{
+  const gchar *text = gtk_entry_get_text (entry);
+  const gchar *warning = NULL;
+
+  const gchar *p = text;
+  while (g_ascii_isspace (*p))
+    p++;
+
+  std::vector<bool> cpus;
+  if (!cpufreq_parse_cpu_list (text, cpuFreq->cpus.size(), cpus))
+    warning = _("Invalid list of CPUs, all CPUs are used");
+  else if (*p != '\0' && std::find (cpus.begin(), cpus.end(), true) == cpus.end())
+    warning = _("None of the listed CPUs exist, all CPUs are used");
+
+  gtk_entry_set_icon_from_icon_name (entry, GTK_ENTRY_ICON_SECONDARY, warning ? "dialog-warning" : NULL);
+  gtk_entry_set_icon_tooltip_text (entry, GTK_ENTRY_ICON_SECONDARY, warning);
+}
+
+
+
+/*
+ * Applies the CPU set once editing is done, not on every keystroke.
+ */
+static void
+entry_cpu_set_apply (GtkEntry *entry)
+{
+  const gchar *text = gtk_entry_get_text (entry);
+  if (cpuFreq->options->show_cpu_set == text)
+    return;
+
+  entry_cpu_set_validate (entry);
+  cpuFreq->options->show_cpu_set = text;
+  cpufreq_update_cpu_set ();
+  cpufreq_update_plugin (true);
+}
+
+
+
 static void
 spinner_changed (GtkSpinButton *spinner)
 {
@@ -277,6 +345,23 @@ spinner_changed (GtkSpinButton *spinner)
 
 
 
+static void
+spinner_max_changed (GtkSpinButton *spinner)
+{
+  cpuFreq->options->timeout_max = gtk_spin_button_get_value (spinner);
+  cpufreq_restart_timeout ();
+}
+
+
+
+static void
+spinner_slices_changed (GtkSpinButton *spinner)
+{
+  cpuFreq->options->sample_slices = gtk_spin_button_get_value_as_int (spinner);
+}
+
+
+
 static void
 cpufreq_configure_response (GtkDialog *dialog)
 {
@@ -358,6 +443,63 @@ cpufreq_configure (XfcePanelPlugin *plugin)
       spinner_changed (sb);
   });
 
+  button = configure->timeout_adaptive = gtk_check_button_new_with_mnemonic (_("_Adapt the interval while frequencies are stable"));
+  gtk_container_add (GTK_CONTAINER (align), button);
+  gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (button), options->timeout_adaptive);
+  xfce4::connect_toggled (GTK_TOGGLE_BUTTON (button), [configure](GtkToggleButton *b) {
+      check_button_changed (GTK_WIDGET (b), configure);
+  });
+
+  hbox = configure->timeout_max_hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 12);
+  gtk_container_add (GTK_CONTAINER (align), hbox);
+
+  label = gtk_label_new_with_mnemonic (_("_Maximum interval:"));
+  gtk_box_pack_start (GTK_BOX (hbox), label, false, false, 0);
+  gtk_widget_set_valign (label, GTK_ALIGN_CENTER);
+  gtk_size_group_add_widget (sg0, label);
+
+  spinner = configure->spinner_timeout_max = gtk_spin_button_new_with_range (TIMEOUT_MIN, TIMEOUT_MAX, TIMEOUT_STEP);
+  gtk_label_set_mnemonic_widget (GTK_LABEL (label), spinner);
+  gtk_spin_button_set_digits (GTK_SPIN_BUTTON (spinner), 2);
+  gtk_spin_button_set_value (GTK_SPIN_BUTTON (spinner), options->timeout_max);
+  gtk_box_pack_start (GTK_BOX (hbox), spinner, false, false, 0);
+  xfce4::connect_value_changed (GTK_SPIN_BUTTON (spinner), [](GtkSpinButton *sb) {
+      spinner_max_changed (sb);
+  });
+
+  hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 12);
+  gtk_container_add (GTK_CONTAINER (align), hbox);
+
+  label = gtk_label_new_with_mnemonic (_("_Sample CPUs in slices:"));
+  gtk_box_pack_start (GTK_BOX (hbox), label, false, false, 0);
+  gtk_widget_set_valign (label, GTK_ALIGN_CENTER);
+  gtk_widget_set_tooltip_text (label, _("Read only a rotating part of the CPUs at each update of min, avg or max"));
+  gtk_size_group_add_widget (sg0, label);
+
+  spinner = configure->spinner_slices = gtk_spin_button_new_with_range (1, SAMPLE_SLICES_MAX, 1);
+  gtk_label_set_mnemonic_widget (GTK_LABEL (label), spinner);
+  gtk_spin_button_set_value (GTK_SPIN_BUTTON (spinner), options->sample_slices);
+  gtk_box_pack_start (GTK_BOX (hbox), spinner, false, false, 0);
+  xfce4::connect_value_changed (GTK_SPIN_BUTTON (spinner), [](GtkSpinButton *sb) {
+      spinner_slices_changed (sb);
+  });
+
+  button = configure->sample_isolated = gtk_check_button_new_with_mnemonic (_("Sample _isolated CPUs"));
+  gtk_widget_set_tooltip_text (button, _("Read the frequency of CPUs reserved by isolcpus or nohz_full, without interrupting them"));
+  gtk_container_add (GTK_CONTAINER (align), button);
+  gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (button), options->sample_isolated);
+  xfce4::connect_toggled (GTK_TOGGLE_BUTTON (button), [configure](GtkToggleButton *b) {
+      check_button_changed (GTK_WIDGET (b), configure);
+  });
+
+  button = configure->scope_affinity = gtk_check_button_new_with_mnemonic (_("Only CPUs _available to this session"));
+  gtk_widget_set_tooltip_text (button, _("Sample and aggregate only the CPUs allowed by the CPU affinity and the cgroup cpuset"));
+  gtk_container_add (GTK_CONTAINER (align), button);
+  gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (button), options->scope_affinity);
+  xfce4::connect_toggled (GTK_TOGGLE_BUTTON (button), [configure](GtkToggleButton *b) {
+      check_button_changed (GTK_WIDGET (b), configure);
+  });
+
   /* panel behaviours */
   frame = gtk_frame_new (NULL);
   gtk_box_pack_start (GTK_BOX (dialog_vbox), frame, false, true, 0);
@@ -448,6 +590,7 @@ cpufreq_configure (XfcePanelPlugin *plugin)
     gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT (combo), _("min"));
     gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT (combo), _("avg"));
     gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT (combo), _("max"));
+    gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT (combo), _("median"));
 
   retry_cpu:
     switch (options->show_cpu)
@@ -461,6 +604,9 @@ cpufreq_configure (XfcePanelPlugin *plugin)
     case CPU_MAX:
       gtk_combo_box_set_active (GTK_COMBO_BOX (combo), cpuFreq->cpus.size() + 2);
       break;
+    case CPU_MEDIAN:
+      gtk_combo_box_set_active (GTK_COMBO_BOX (combo), cpuFreq->cpus.size() + 3);
+      break;
     default:
       if (options->show_cpu >= 0 && guint(options->show_cpu) < cpuFreq->cpus.size())
         gtk_combo_box_set_active (GTK_COMBO_BOX (combo), options->show_cpu);
@@ -476,6 +622,33 @@ cpufreq_configure (XfcePanelPlugin *plugin)
     });
   }
 
+  /* which cpus min, avg, max and median are computed from */
+  {
+    hbox = configure->cpu_set_hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 12);
+    gtk_box_pack_start (GTK_BOX (vbox), hbox, false, false, 0);
+
+    label = gtk_label_new_with_mnemonic (_("CPU _set:"));
+    gtk_box_pack_start (GTK_BOX (hbox), label, false, false, 0);
+    gtk_widget_set_valign (label, GTK_ALIGN_CENTER);
+    gtk_label_set_xalign (GTK_LABEL (label), 0);
+    gtk_size_group_add_widget (sg0, label);
+
+    GtkWidget *entry = configure->entry_cpu_set = gtk_entry_new ();
+    gtk_entry_set_text (GTK_ENTRY (entry), options->show_cpu_set.c_str());
+    entry_cpu_set_validate (GTK_ENTRY (entry));
+    gtk_entry_set_placeholder_text (GTK_ENTRY (entry), _("All CPUs"));
+    gtk_widget_set_tooltip_text (entry, _("CPUs to compute min, avg, max or median from, for example 0-7,16-23"));
+    gtk_box_pack_start (GTK_BOX (hbox), entry, false, true, 0);
+    gtk_label_set_mnemonic_widget (GTK_LABEL (label), entry);
+    xfce4::connect_activate (GTK_ENTRY (entry), [](GtkEntry *e) {
+        entry_cpu_set_apply (e);
+    });
+    xfce4::connect_focus_out (entry, [](GtkWidget *w, GdkEventFocus *event) {
+        entry_cpu_set_apply (GTK_ENTRY (w));
+        return xfce4::PROPAGATE;
+    });
+  }
+
   /* which unit to use when displaying the frequency */
   {
     hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 12);
@@ -560,7 +733,8 @@ cpufreq_configure (XfcePanelPlugin *plugin)
       check_button_changed (GTK_WIDGET (b), configure);
   });
 
-  xfce4::connect_response (GTK_DIALOG (dialog), [](GtkDialog *widget, gint response) {
+  xfce4::connect_response (GTK_DIALOG (dialog), [configure](GtkDialog *widget, gint response) {
+      entry_cpu_set_apply (GTK_ENTRY (configure->entry_cpu_set));
       cpufreq_configure_response (widget);
   });
 
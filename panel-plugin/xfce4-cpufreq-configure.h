@@ -33,8 +33,14 @@ struct CpuFreqPluginConfigure
   GtkWidget *icon_color_freq = nullptr;
   GtkWidget *monitor_timeout = nullptr;
   GtkWidget *combo_cpu = nullptr;
+  GtkWidget *entry_cpu_set = nullptr, *cpu_set_hbox = nullptr;
   GtkWidget *combo_unit = nullptr;
   GtkWidget *spinner_timeout = nullptr;
+  GtkWidget *timeout_adaptive = nullptr;
+  GtkWidget *spinner_timeout_max = nullptr, *timeout_max_hbox = nullptr;
+  GtkWidget *spinner_slices = nullptr;
+  GtkWidget *sample_isolated = nullptr;
+  GtkWidget *scope_affinity = nullptr;
   GtkWidget *keep_compact = nullptr;
   GtkWidget *one_line = nullptr;
   GtkWidget *fontcolor = nullptr, *fontcolor_hbox = nullptr;
@@ -50,4 +56,6 @@ cpufreq_configure (XfcePanelPlugin *plugin);
 #define TIMEOUT_MAX	10.0
 #define TIMEOUT_STEP	0.25
 
+#define SAMPLE_SLICES_MAX	16
+
 #endif /* XFCE4_CPUFREQ_CONFIGURE_H */
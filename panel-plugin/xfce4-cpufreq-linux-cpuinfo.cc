@@ -0,0 +1,149 @@
+/*  xfce4-cpu-freq-plugin - panel plugin for cpu informations
+ *
+ *  Copyright (c) 2026 The Xfce development team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "xfce4-cpufreq-linux-cpuinfo.h"
+
+#define CPUINFO_KEY        "cpu MHz"
+#define CPUINFO_CHUNK_SIZE (64 * 1024)
+#define CPUINFO_LINE_MAX   256  /* an incomplete "cpu MHz" line can't be longer */
+
+static bool cpuinfo_line_has_prefix (const gchar *line, gsize len);
+
+static bool cpuinfo_parse_line (const gchar *line, gsize len, const CpuInfoFreqHandler &handler, guint index);
+
+
+
+/*
+ * The file, which can be megabytes long on large hosts, is read in large chunks.
+ * Only the start of each line is examined, the remaining lines (such as the long
+ * "flags" lines) are skipped using memchr() without being copied.
+ */
+bool
+cpufreq_cpuinfo_parse (const gchar *path, const CpuInfoFreqHandler &handler)
+{
+  int fd = open (path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+
+  gchar buf[CPUINFO_CHUNK_SIZE];
+  gsize len = 0;          /* length of the incomplete line at the start of buf */
+  bool skipping = false;  /* the rest of the current line is skipped */
+  guint index = 0;
+
+  while (true)
+  {
+    ssize_t n = read (fd, buf + len, sizeof (buf) - len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+    {
+      /* the last line might not be terminated */
+      if (n == 0 && len != 0 && !skipping && cpuinfo_parse_line (buf, len, handler, index))
+        index++;
+      break;
+    }
+
+    const gchar *p = buf;
+    const gchar *const end = buf + len + n;
+    while (p < end)
+    {
+      const gchar *eol = (const gchar*) memchr (p, '\n', end - p);
+      if (skipping)
+      {
+        if (eol == NULL)
+        {
+          p = end;
+          break;
+        }
+        skipping = false;
+      }
+      else if (eol == NULL)
+      {
+        /* An incomplete line is kept only if it can be a "cpu MHz" line */
+        if (end - p > CPUINFO_LINE_MAX || !cpuinfo_line_has_prefix (p, end - p))
+        {
+          skipping = true;
+          p = end;
+        }
+        break;
+      }
+      else if (cpuinfo_parse_line (p, eol - p, handler, index))
+        index++;
+
+      p = eol + 1;
+    }
+
+    len = end - p;
+    memmove (buf, p, len);
+  }
+
+  close (fd);
+  return true;
+}
+
+
+
+static bool
+cpuinfo_line_has_prefix (const gchar *line, gsize len)
+{
+  const gsize n = MIN (len, strlen (CPUINFO_KEY));
+  return g_ascii_strncasecmp (line, CPUINFO_KEY, n) == 0;
+}
+
+
+
+/*
+ * Parses a line such as "cpu MHz		: 2400.123". The line isn't NUL-terminated.
+ */
+static bool
+cpuinfo_parse_line (const gchar *line, gsize len, const CpuInfoFreqHandler &handler, guint index)
+{
+  if (len < strlen (CPUINFO_KEY) || !cpuinfo_line_has_prefix (line, len))
+    return false;
+
+  const gchar *const end = line + len;
+  const gchar *p = (const gchar*) memchr (line, ':', len);
+  if (p == NULL)
+    return false;
+
+  p++;
+  while (p < end && g_ascii_isspace (*p))
+    p++;
+
+  /* MHz with up to three decimal places, converted to kHz */
+  guint64 mhz = 0;
+  while (p < end && g_ascii_isdigit (*p) && mhz < G_MAXUINT)
+    mhz = 10 * mhz + (*p++ - '0');
+
+  guint64 khz = 1000 * mhz;
+  if (p < end && *p == '.')
+  {
+    p++;
+    for (guint scale = 100; scale != 0 && p < end && g_ascii_isdigit (*p); scale /= 10)
+      khz += scale * (*p++ - '0');
+  }
+
+  handler (index, khz <= G_MAXUINT ? guint (khz) : 0);
+  return true;
+}
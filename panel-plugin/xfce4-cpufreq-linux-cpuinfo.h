@@ -0,0 +1,37 @@
+/*  xfce4-cpu-freq-plugin - panel plugin for cpu informations
+ *
+ *  Copyright (c) 2026 The Xfce development team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef XFCE4_CPUFREQ_LINUX_CPUINFO_H
+#define XFCE4_CPUFREQ_LINUX_CPUINFO_H
+
+#include <functional>
+#include <glib.h>
+
+#define CPUINFO_FILE "/proc/cpuinfo"
+
+typedef std::function<void (guint index, guint freq)> CpuInfoFreqHandler;
+
+/*
+ * Parses the "cpu MHz" lines of a file in the format of /proc/cpuinfo and calls
+ * 'handler' with the index of the line and the frequency in kHz.
+ * Returns false if the file cannot be opened.
+ */
+bool cpufreq_cpuinfo_parse (const gchar *path, const CpuInfoFreqHandler &handler);
+
+#endif /* XFCE4_CPUFREQ_LINUX_CPUINFO_H */
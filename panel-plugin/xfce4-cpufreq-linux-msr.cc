@@ -0,0 +1,183 @@
+/*  xfce4-cpu-freq-plugin - panel plugin for cpu informations
+ *
+ *  Copyright (c) 2026 The Xfce development team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * 'scaling_cur_freq' is a point sample of the CPU frequency. The APERF counter
+ * of a CPU core counts actual clock cycles and the MPERF counter counts cycles
+ * at the reference (TSC) frequency, both only while the core isn't halted.
+ * The average effective frequency over a refresh interval is therefore:
+ *
+ *   TSC frequency * ΔAPERF / ΔMPERF
+ *
+ * The TSC frequency is derived from the TSC delta and the elapsed time.
+ * This is the same way turbostat computes the busy frequency.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "xfce4-cpufreq-linux-msr.h"
+
+#define MSR_IA32_TSC   0x10
+#define MSR_IA32_MPERF 0xe7
+#define MSR_IA32_APERF 0xe8
+
+struct CpuFreqMsrCpu
+{
+  int fd = -1;
+  bool has_sample = false;
+  guint64 tsc = 0, mperf = 0, aperf = 0;
+  gint64 time = 0;  /* monotonic time in microseconds */
+};
+
+struct CpuFreqMsr
+{
+  std::string base;
+  std::vector<CpuFreqMsrCpu> cpus;
+
+  ~CpuFreqMsr();
+};
+
+
+
+static int
+open_msr (const CpuFreqMsr *msr, gsize cpu)
+{
+  gchar *file = g_strdup_printf ("%s/%zu/msr", msr->base.c_str(), cpu);
+  int fd = open (file, O_RDONLY | O_CLOEXEC);
+  g_free (file);
+  return fd;
+}
+
+
+
+static bool
+read_msr (int fd, guint32 reg, guint64 *value)
+{
+  return pread (fd, value, sizeof (*value), reg) == sizeof (*value);
+}
+
+
+
+xfce4::Ptr0<CpuFreqMsr>
+cpufreq_msr_new (const gchar *base, const std::vector<bool> &isolated)
+{
+#if defined(__i386__) || defined(__x86_64__)
+  const gsize count = isolated.size();
+
+  /* Probe on the first CPU that may be interrupted */
+  gsize first = 0;
+  while (first < count && isolated[first])
+    first++;
+  if (first == count)
+    return nullptr;
+
+  auto msr = xfce4::make<CpuFreqMsr>();
+  msr->base = base;
+  msr->cpus.resize (count);
+
+  /* The msr module needs to be loaded, the process needs the permission
+     to read the device, and the CPU needs to support APERF/MPERF */
+  int fd = open_msr (&*msr, first);
+  if (fd < 0)
+  {
+    g_debug ("Cannot open %s/%zu/msr: %s", base, first, g_strerror (errno));
+    return nullptr;
+  }
+  msr->cpus[first].fd = fd;
+
+  guint64 value;
+  if (!read_msr (fd, MSR_IA32_APERF, &value) || !read_msr (fd, MSR_IA32_MPERF, &value))
+  {
+    g_debug ("APERF/MPERF cannot be read from %s/%zu/msr", base, first);
+    return nullptr;
+  }
+
+  for (gsize i = first + 1; i < count; i++)
+    if (!isolated[i])
+      msr->cpus[i].fd = open_msr (&*msr, i);
+
+  return msr;
+#else
+  return nullptr;
+#endif
+}
+
+
+
+bool
+cpufreq_msr_read_freq (CpuFreqMsr *msr, gsize cpu, guint *freq)
+{
+  if (G_UNLIKELY (cpu >= msr->cpus.size()))
+    return false;
+
+  CpuFreqMsrCpu &c = msr->cpus[cpu];
+  if (c.fd < 0)
+  {
+    /* The CPU might have been offline when its msr device was opened */
+    c.fd = open_msr (msr, cpu);
+    if (c.fd < 0)
+      return false;
+  }
+
+  guint64 tsc, mperf, aperf;
+  gint64 time = g_get_monotonic_time ();
+  if (!read_msr (c.fd, MSR_IA32_TSC, &tsc) ||
+      !read_msr (c.fd, MSR_IA32_MPERF, &mperf) ||
+      !read_msr (c.fd, MSR_IA32_APERF, &aperf))
+  {
+    /* The CPU is offline or has been removed */
+    close (c.fd);
+    c.fd = -1;
+    c.has_sample = false;
+    return false;
+  }
+
+  bool ok = false;
+  if (c.has_sample && time > c.time && tsc > c.tsc && mperf > c.mperf && aperf >= c.aperf)
+  {
+    /* TSC ticks per microsecond = MHz */
+    gdouble tsc_mhz = gdouble (tsc - c.tsc) / (time - c.time);
+    gdouble khz = 1000 * tsc_mhz * (gdouble (aperf - c.aperf) / (mperf - c.mperf));
+    if (khz >= 0 && khz < G_MAXUINT)
+    {
+      *freq = guint (khz);
+      ok = true;
+    }
+  }
+
+  c.tsc = tsc;
+  c.mperf = mperf;
+  c.aperf = aperf;
+  c.time = time;
+  c.has_sample = true;
+  return ok;
+}
+
+
+
+CpuFreqMsr::~CpuFreqMsr()
+{
+  for (CpuFreqMsrCpu &c : cpus)
+    if (c.fd >= 0)
+      close (c.fd);
+}
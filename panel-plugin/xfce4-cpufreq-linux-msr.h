@@ -0,0 +1,49 @@
+/*  xfce4-cpu-freq-plugin - panel plugin for cpu informations
+ *
+ *  Copyright (c) 2026 The Xfce development team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef XFCE4_CPUFREQ_LINUX_MSR_H
+#define XFCE4_CPUFREQ_LINUX_MSR_H
+
+#include <glib.h>
+#include <vector>
+#include "xfce4++/util.h"
+
+/* The msr device of CPU N is MSR_BASE/N/msr */
+#define MSR_BASE "/dev/cpu"
+
+struct CpuFreqMsr;
+
+/*
+ * Opens the msr devices base/N/msr of CPUs 0..isolated.size()-1. Reading an msr of another CPU
+ * interrupts it, so the support is probed on the first CPU that isn't marked in 'isolated',
+ * and the devices of isolated CPUs are opened only when they are read for the first time.
+ * Returns nullptr if the msr devices are unavailable or if access to them isn't permitted.
+ */
+xfce4::Ptr0<CpuFreqMsr> cpufreq_msr_new (const gchar *base, const std::vector<bool> &isolated);
+
+/*
+ * Computes the average effective frequency (in kHz) of the CPU since the previous call,
+ * using the APERF and MPERF counters. Returns false if the frequency isn't known,
+ * for example on the first call or if the CPU is offline.
+ *
+ * Calls for different CPUs can be made from different threads concurrently.
+ */
+bool cpufreq_msr_read_freq (CpuFreqMsr *msr, gsize cpu, guint *freq);
+
+#endif /* XFCE4_CPUFREQ_LINUX_MSR_H */
@@ -0,0 +1,223 @@
+/*  xfce4-cpu-freq-plugin - panel plugin for cpu informations
+ *
+ *  Copyright (c) 2026 The Xfce development team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * For each CPU, a perf event group consisting of the 'cycles' counter (actual clock
+ * cycles) and the 'ref-cycles' counter (cycles at the constant TSC frequency) is opened.
+ * Both counters count only while the CPU isn't halted, so the average effective
+ * frequency over a refresh interval is:
+ *
+ *   TSC frequency * Δcycles / Δref-cycles
+ *
+ * A single read() of the group leader returns both counters.
+ */
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+#include "xfce4-cpufreq-linux-perf.h"
+
+struct CpuFreqPerfCpu
+{
+  int cycles = -1;      /* group leader */
+  int ref_cycles = -1;
+  bool isolated = false;  /* the counters are never opened */
+  bool has_sample = false;
+  guint64 prev_cycles = 0, prev_ref_cycles = 0, prev_tsc = 0;
+  gint64 prev_time = 0;  /* monotonic time in microseconds */
+
+  bool open (gsize cpu);
+  void close ();
+};
+
+struct CpuFreqPerf
+{
+  std::vector<CpuFreqPerfCpu> cpus;
+
+  ~CpuFreqPerf();
+};
+
+
+
+static int
+perf_event_open (guint64 config, gsize cpu, int group_fd)
+{
+  struct perf_event_attr attr = {};
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof (attr);
+  attr.config = config;
+  attr.read_format = PERF_FORMAT_GROUP;
+
+  return syscall (__NR_perf_event_open, &attr, -1, int (cpu), group_fd, PERF_FLAG_FD_CLOEXEC);
+}
+
+
+
+bool
+CpuFreqPerfCpu::open (gsize cpu)
+{
+  if (isolated)
+    return false;
+
+  cycles = perf_event_open (PERF_COUNT_HW_CPU_CYCLES, cpu, -1);
+  if (cycles < 0)
+    return false;
+
+  ref_cycles = perf_event_open (PERF_COUNT_HW_REF_CPU_CYCLES, cpu, cycles);
+  if (ref_cycles < 0)
+  {
+    close ();
+    return false;
+  }
+
+  has_sample = false;
+  return true;
+}
+
+
+
+void
+CpuFreqPerfCpu::close ()
+{
+  if (ref_cycles >= 0)
+  {
+    ::close (ref_cycles);
+    ref_cycles = -1;
+  }
+  if (cycles >= 0)
+  {
+    ::close (cycles);
+    cycles = -1;
+  }
+  has_sample = false;
+}
+
+
+
+xfce4::Ptr0<CpuFreqPerf>
+cpufreq_perf_new (const std::vector<bool> &isolated)
+{
+#if defined(__i386__) || defined(__x86_64__)
+  const gsize count = isolated.size();
+
+  /* Probe on the first CPU that may be interrupted */
+  gsize first = 0;
+  while (first < count && isolated[first])
+    first++;
+  if (first == count)
+    return nullptr;
+
+  auto perf = xfce4::make<CpuFreqPerf>();
+  perf->cpus.resize (count);
+  for (gsize i = 0; i < count; i++)
+    perf->cpus[i].isolated = isolated[i];
+
+  if (!perf->cpus[first].open (first))
+  {
+    if (errno == EACCES || errno == EPERM)
+      g_debug ("CPU-wide perf events are not permitted by /proc/sys/kernel/perf_event_paranoid");
+    else
+      g_debug ("Cannot open cycle counters: %s", g_strerror (errno));
+    return nullptr;
+  }
+
+  for (gsize i = first + 1; i < count; i++)
+    perf->cpus[i].open (i);
+
+  return perf;
+#else
+  /* The TSC is used to measure the reference frequency */
+  return nullptr;
+#endif
+}
+
+
+
+bool
+cpufreq_perf_read_freq (CpuFreqPerf *perf, gsize cpu, guint *freq)
+{
+#if defined(__i386__) || defined(__x86_64__)
+  if (G_UNLIKELY (cpu >= perf->cpus.size()))
+    return false;
+
+  CpuFreqPerfCpu &c = perf->cpus[cpu];
+  if (c.cycles < 0 && !c.open (cpu))
+    return false;
+
+  /* struct read_format { u64 nr; u64 values[nr]; } */
+  guint64 data[3];
+  gint64 time = g_get_monotonic_time ();
+  guint64 tsc = __rdtsc ();
+  if (read (c.cycles, data, sizeof (data)) != sizeof (data) || data[0] != 2)
+  {
+    c.close ();
+    return false;
+  }
+
+  const guint64 cycles = data[1], ref_cycles = data[2];
+
+  bool ok = false;
+  if (c.has_sample && time > c.prev_time && tsc > c.prev_tsc &&
+      cycles >= c.prev_cycles && ref_cycles > c.prev_ref_cycles)
+  {
+    /* TSC ticks per microsecond = MHz */
+    gdouble tsc_mhz = gdouble (tsc - c.prev_tsc) / (time - c.prev_time);
+    gdouble khz = 1000 * tsc_mhz * (gdouble (cycles - c.prev_cycles) / (ref_cycles - c.prev_ref_cycles));
+    if (khz >= 0 && khz < G_MAXUINT)
+    {
+      *freq = guint (khz);
+      ok = true;
+    }
+  }
+
+  c.prev_cycles = cycles;
+  c.prev_ref_cycles = ref_cycles;
+  c.prev_tsc = tsc;
+  c.prev_time = time;
+  c.has_sample = true;
+  return ok;
+#else
+  return false;
+#endif
+}
+
+
+
+void
+cpufreq_perf_reset (CpuFreqPerf *perf, gsize cpu)
+{
+  if (cpu < perf->cpus.size())
+    perf->cpus[cpu].close ();
+}
+
+
+
+CpuFreqPerf::~CpuFreqPerf()
+{
+  for (CpuFreqPerfCpu &c : cpus)
+    c.close ();
+}
@@ -0,0 +1,53 @@
+/*  xfce4-cpu-freq-plugin - panel plugin for cpu informations
+ *
+ *  Copyright (c) 2026 The Xfce development team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef XFCE4_CPUFREQ_LINUX_PERF_H
+#define XFCE4_CPUFREQ_LINUX_PERF_H
+
+#include <glib.h>
+#include <vector>
+#include "xfce4++/util.h"
+
+struct CpuFreqPerf;
+
+/*
+ * Opens a group of cycle counters for each of the CPUs 0..isolated.size()-1,
+ * except for the CPUs marked in 'isolated': enabling a counter interrupts the CPU,
+ * so their counters are never opened and cpufreq_perf_read_freq() fails for them.
+ * Returns nullptr if the counters are unavailable, for example
+ * if /proc/sys/kernel/perf_event_paranoid doesn't permit CPU-wide events.
+ */
+xfce4::Ptr0<CpuFreqPerf> cpufreq_perf_new (const std::vector<bool> &isolated);
+
+/*
+ * Computes the average effective frequency (in kHz) of the CPU since the previous call.
+ * Returns false if the frequency isn't known, for example on the first call,
+ * if the CPU is offline or if the CPU was idle during the whole interval.
+ *
+ * Calls for different CPUs can be made from different threads concurrently.
+ */
+bool cpufreq_perf_read_freq (CpuFreqPerf *perf, gsize cpu, guint *freq);
+
+/*
+ * Closes the counters of the CPU. They are reopened by the next cpufreq_perf_read_freq().
+ * Used when the CPU has been hotplugged.
+ */
+void cpufreq_perf_reset (CpuFreqPerf *perf, gsize cpu);
+
+#endif /* XFCE4_CPUFREQ_LINUX_PERF_H */
@@ -18,8 +18,13 @@
  *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <functional>
+#include <string.h>
+
 #include "xfce4-cpufreq-plugin.h"
+#include "xfce4-cpufreq-linux-cpuinfo.h"
 #include "xfce4-cpufreq-linux-procfs.h"
+#include "xfce4-cpufreq-utils.h"
 
 #define PROCFS_BASE "/proc/cpufreq"
 
@@ -36,58 +41,53 @@ cpufreq_procfs_is_available ()
 bool
 cpufreq_procfs_read_cpuinfo ()
 {
-  const char *const filePath = "/proc/cpuinfo";
-
-  if (!g_file_test (filePath, G_FILE_TEST_EXISTS))
+  if (!g_file_test (CPUINFO_FILE, G_FILE_TEST_EXISTS))
     return false;
 
-  FILE *file = fopen (filePath, "r");
+  cpufreq_cpuinfo_parse (CPUINFO_FILE, [](guint i, guint freq) {
+    Ptr0<CpuInfo> cpu;
+    bool add_cpu = false;
 
-  if (file)
-  {
-    gchar line[256];
-    guint i = 0;
-    while (fgets (line, sizeof(line), file) != NULL)
+    if (i < cpuFreq->cpus.size())
+      cpu = cpuFreq->cpus[i];
+
+    if (cpu == nullptr)
     {
-      if (g_ascii_strncasecmp (line, "cpu MHz", 7) == 0)
-      {
-        Ptr0<CpuInfo> cpu;
-        bool add_cpu = false;
+      cpu = xfce4::make<CpuInfo>();
+      cpu->update_shared ([](CpuInfo::Shared &shared) { shared.online = true; });
+      add_cpu = true;
+    }
 
-        if (i < cpuFreq->cpus.size())
-          cpu = cpuFreq->cpus[i];
+    cpu->update_shared ([freq](CpuInfo::Shared &shared) { shared.cur_freq = freq; });
 
-        if (cpu == nullptr)
-        {
-          cpu = xfce4::make<CpuInfo>();
-          {
-            std::lock_guard<std::mutex> guard(cpu->mutex);
-            cpu->shared.online = true;
-          }
-          add_cpu = true;
-        }
+    if (add_cpu)
+      cpuFreq->cpus.push_back(cpu.toPtr());
+  });
 
-        gchar *freq = g_strrstr (line, ":");
-        if (freq == NULL)
-          break;
+  return true;
+}
 
-        {
-            std::lock_guard<std::mutex> guard(cpu->mutex);
-            sscanf (++freq, "%d.", &cpu->shared.cur_freq);
-            cpu->shared.cur_freq *= 1000;
-        }
 
-        if (add_cpu)
-          cpuFreq->cpus.push_back(cpu.toPtr());
 
-        ++i;
-      }
-    }
-
-    fclose (file);
-  }
-
-  return true;
+void
+cpufreq_procfs_read_cpuinfo_current (const std::function<void()> &done)
+{
+  /* Start a new read only if the previous read has finished */
+  xfce4::LaunchConfig config;
+  config.start_if_busy = false;
+  config.done = done;
+
+  const std::vector<Ptr<CpuInfo>> cpus = cpuFreq->cpus;
+  if (cpus.empty())
+    return;
+
+  /* Generating /proc/cpuinfo can take a long time on large hosts */
+  xfce4::singleThreadQueue->start(config, [cpus]() {
+      cpufreq_cpuinfo_parse (CPUINFO_FILE, [&cpus](guint i, guint freq) {
+        if (i < cpus.size())
+          cpus[i]->update_shared ([freq](CpuInfo::Shared &shared) { shared.cur_freq = freq; });
+      });
+  });
 }
 
 
@@ -104,34 +104,57 @@ cpufreq_procfs_read ()
 
   if (file)
   {
+    /* The existing CpuInfo objects are updated in place, which keeps max_freq_measured */
+    std::vector<Ptr<CpuInfo>> &cpus = cpuFreq->cpus;
+    bool changed = false;
+    size_t count = 0;
+
     gchar line[256];
     while (fgets (line, sizeof(line), file) != NULL)
     {
       if (g_ascii_strncasecmp (line, "CPU", 3) == 0)
       {
-        auto cpu = xfce4::make<CpuInfo>();
+        if (count == cpus.size())
+        {
+          cpus.push_back(xfce4::make<CpuInfo>());
+          changed = true;
+        }
+        const Ptr<CpuInfo> &cpu = cpus[count++];
 
-        char gov[21];
+        guint min_freq = 0, max_freq = 0;
+        char gov[21] = "";
         sscanf (line,
                 "CPU %*d %d kHz (%*d %%) - %d kHz (%*d %%) - %20s",
-                &cpu->min_freq,
-                &cpu->max_freq_nominal,
+                &min_freq,
+                &max_freq,
                 gov);
-        cpu->min_freq *= 1000;
-        cpu->max_freq_nominal *= 1000;
+        cpu->min_freq = min_freq * 1000;
+        cpu->max_freq_nominal = max_freq * 1000;
         gov[G_N_ELEMENTS(gov)-1] = '\0';
 
+        const GovernorId governor = cpufreq_governor_intern (gov, strlen (gov));
+        const CpuInfo::Shared shared = cpu->load_shared();
+        if (!shared.online || shared.cur_governor != governor)
         {
-            std::lock_guard<std::mutex> guard(cpu->mutex);
-            cpu->shared.online = true;
-            cpu->shared.cur_governor = gov;
+          cpu->update_shared ([governor](CpuInfo::Shared &s) {
+            s.online = true;
+            s.cur_governor = governor;
+          });
+          changed = true;
         }
-
-        cpuFreq->cpus.push_back(cpu);
       }
     }
 
     fclose (file);
+
+    if (count < cpus.size())
+    {
+      cpus.erase (cpus.begin() + count, cpus.end());
+      changed = true;
+    }
+
+    if (changed)
+      cpufreq_governor_generation++;
   }
 
   for (size_t i = 0; i < cpuFreq->cpus.size(); i++)
@@ -151,10 +174,7 @@ cpufreq_procfs_read ()
         cur_freq = 0;
       fclose (file);
 
-      {
-        std::lock_guard<std::mutex> guard(cpu->mutex);
-        cpu->shared.cur_freq = cur_freq;
-      }
+      cpu->update_shared ([cur_freq](CpuInfo::Shared &shared) { shared.cur_freq = cur_freq; });
     }
   }
 
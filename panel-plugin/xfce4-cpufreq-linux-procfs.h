@@ -20,10 +20,15 @@
 #ifndef XFCE4_CPUFREQ_LINUX_PROCFS_H
 #define XFCE4_CPUFREQ_LINUX_PROCFS_H
 
+#include <functional>
+
 bool cpufreq_procfs_is_available ();
 
 bool cpufreq_procfs_read ();
 
 bool cpufreq_procfs_read_cpuinfo ();
 
+/* Reads the current frequencies asynchronously, 'done' is called in the main thread afterwards */
+void cpufreq_procfs_read_cpuinfo_current (const std::function<void()> &done);
+
 #endif /* XFCE4_CPUFREQ_LINUX_PROCFS_H */
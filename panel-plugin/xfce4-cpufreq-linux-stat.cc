@@ -0,0 +1,157 @@
+/*  xfce4-cpu-freq-plugin - panel plugin for cpu informations
+ *
+ *  Copyright (c) 2026 The Xfce development team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Reading the frequency of a CPU that sits in a deep C-state can wake it up:
+ * 'scaling_cur_freq', the perf counters and the msr devices are read on the CPU itself.
+ * The 'cpuN' lines of /proc/stat contain the time each CPU spent in the various states,
+ * in USER_HZ ticks, for all CPUs in a single file. A CPU whose busy time didn't change
+ * since the previous refresh has been idle the whole time, and its frequency doesn't
+ * need to be read again.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#include "xfce4-cpufreq-linux-stat.h"
+
+#define STAT_FILE "/proc/stat"
+
+/* Enough for a "cpuN" line with ten 20-digit fields */
+#define STAT_LINE_MAX 256
+
+/* Fields of a "cpuN" line, after the name */
+enum
+{
+  STAT_USER,
+  STAT_NICE,
+  STAT_SYSTEM,
+  STAT_IDLE,
+  STAT_IOWAIT,
+  STAT_IRQ,
+  STAT_SOFTIRQ,
+  STAT_STEAL,
+  STAT_FIELDS
+};
+
+struct CpuFreqStatCpu
+{
+  bool has_sample = false;
+  bool seen = false;
+  guint64 busy = 0;
+};
+
+struct CpuFreqStat
+{
+  int fd = -1;
+  std::vector<gchar> buf;
+  std::vector<CpuFreqStatCpu> cpus;
+
+  ~CpuFreqStat();
+};
+
+
+
+xfce4::Ptr0<CpuFreqStat>
+cpufreq_stat_new (gsize count)
+{
+  if (count == 0)
+    return nullptr;
+
+  int fd = open (STAT_FILE, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    g_debug ("Cannot open " STAT_FILE ": %s", g_strerror (errno));
+    return nullptr;
+  }
+
+  auto stat = xfce4::make<CpuFreqStat>();
+  stat->fd = fd;
+  stat->cpus.resize (count);
+
+  /* The "cpuN" lines come first, the rest of the file isn't needed */
+  stat->buf.resize ((count + 1) * STAT_LINE_MAX + 1);
+
+  return stat;
+}
+
+
+
+bool
+cpufreq_stat_read_idle (CpuFreqStat *stat, guint8 *idle, gsize count)
+{
+  const gssize len = pread (stat->fd, stat->buf.data(), stat->buf.size() - 1, 0);
+  if (len <= 0)
+    return false;
+  stat->buf[len] = '\0';
+
+  for (CpuFreqStatCpu &c : stat->cpus)
+    c.seen = false;
+
+  /* Offline CPUs have no line */
+  const gchar *s = stat->buf.data();
+  while (g_str_has_prefix (s, "cpu"))
+  {
+    const gchar *eol = strchr (s, '\n');
+    if (eol == NULL)
+      break;
+
+    /* Skip the "cpu" line that sums up all CPUs */
+    gchar *end = NULL;
+    const guint64 cpu = g_ascii_isdigit (s[3]) ? g_ascii_strtoull (s + 3, &end, 10) : G_MAXUINT64;
+    if (cpu < stat->cpus.size())
+    {
+      guint64 fields[STAT_FIELDS] = {};
+      for (gint f = 0; f < STAT_FIELDS && end < eol; f++)
+        fields[f] = g_ascii_strtoull (end, &end, 10);
+
+      /* Guest time is included in user time */
+      const guint64 busy = fields[STAT_USER] + fields[STAT_NICE] + fields[STAT_SYSTEM] +
+                           fields[STAT_IRQ] + fields[STAT_SOFTIRQ] + fields[STAT_STEAL];
+      CpuFreqStatCpu &c = stat->cpus[cpu];
+      if (cpu < count)
+        idle[cpu] = c.has_sample && busy == c.busy;
+      c.busy = busy;
+      c.seen = true;
+    }
+
+    s = eol + 1;
+  }
+
+  for (gsize i = 0; i < stat->cpus.size(); i++)
+  {
+    CpuFreqStatCpu &c = stat->cpus[i];
+    if (!c.seen && i < count)
+      idle[i] = 0;
+    c.has_sample = c.seen;
+  }
+
+  return true;
+}
+
+
+
+CpuFreqStat::~CpuFreqStat()
+{
+  if (fd >= 0)
+    close (fd);
+}
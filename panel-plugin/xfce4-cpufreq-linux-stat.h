@@ -0,0 +1,44 @@
+/*  xfce4-cpu-freq-plugin - panel plugin for cpu informations
+ *
+ *  Copyright (c) 2026 The Xfce development team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef XFCE4_CPUFREQ_LINUX_STAT_H
+#define XFCE4_CPUFREQ_LINUX_STAT_H
+
+#include <glib.h>
+#include "xfce4++/util.h"
+
+struct CpuFreqStat;
+
+/*
+ * Opens /proc/stat for CPUs 0..count-1.
+ * Returns nullptr if /proc/stat cannot be read.
+ */
+xfce4::Ptr0<CpuFreqStat> cpufreq_stat_new (gsize count);
+
+/*
+ * Reads the CPU times from /proc/stat and sets idle[i] to 1 if CPU i didn't
+ * spend any time outside of the idle loop since the previous call, and to 0 otherwise.
+ * CPUs that have no previous sample, for example on the first call
+ * or after they came online, are reported as busy.
+ *
+ * Returns false if /proc/stat couldn't be read, 'idle' is unchanged in that case.
+ */
+bool cpufreq_stat_read_idle (CpuFreqStat *stat, guint8 *idle, gsize count);
+
+#endif /* XFCE4_CPUFREQ_LINUX_STAT_H */
@@ -18,28 +18,298 @@
  *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
-#include <stdlib.h>
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <glib-unix.h>
+#include <mutex>
 #include <string>
 #include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
 #include <vector>
 
 #include "xfce4-cpufreq-plugin.h"
+#include "xfce4-cpufreq-linux.h"
+#include "xfce4-cpufreq-linux-msr.h"
+#include "xfce4-cpufreq-linux-perf.h"
+#include "xfce4-cpufreq-linux-stat.h"
 #include "xfce4-cpufreq-linux-sysfs.h"
+#include "xfce4-cpufreq-linux-uevent.h"
+#include "xfce4-cpufreq-linux-uring.h"
+#include "xfce4-cpufreq-utils.h"
 
 #define SYSFS_BASE  "/sys/devices/system/cpu"
 
-static void cpufreq_sysfs_read_list (const std::string &file, std::vector<guint> &list);
+/* Sysfs attributes are at most one page long */
+#define SYSFS_BUF_SIZE 4096
+
+/* The largest NR_CPUS the kernel can be configured with */
+#define SYSFS_MAX_CPUS 8192
+
+/* How often the governors are re-read even if no change has been reported */
+#define GOVERNOR_REVALIDATE_INTERVAL (10 * G_USEC_PER_SEC)
+
+/*
+ * How often the 'online' files are re-read if CPU hotplug is tracked via uevents.
+ * The kernel sends uevents only to the initial network namespace, in a container
+ * the socket opens fine but stays silent.
+ */
+#define ONLINE_REVALIDATE_INTERVAL (10 * G_USEC_PER_SEC)
+
+/*
+ * A cpufreq policy and the CPUs that share it.
+ * The policy's files are in SYSFS_BASE/dir, for example in SYSFS_BASE/cpufreq/policy0.
+ */
+struct SysfsPolicy
+{
+  std::string dir;
+  std::vector<guint> cpus;  /* sorted */
+
+  bool operator== (const SysfsPolicy &p) const { return dir == p.dir && cpus == p.cpus; }
+};
+
+/*
+ * Sysfs files that are read on every refresh. The files are opened once
+ * and then re-read with pread() at offset 0, which avoids the path formatting,
+ * stat() and open()/close() calls that would otherwise be done for every CPU
+ * on every refresh.
+ *
+ * Only the thread that performs the sysfs sweep of the CPU accesses these fields.
+ */
+struct SysfsCpuFiles
+{
+  std::string dir;  /* "cpuN" */
+  bool isolated = false;
+  int online = -1;
+  bool was_online = true;
+  bool online_read = false;      /* whether 'was_online' was read from the file in this sweep */
+  gint64 online_read_time = 0;
+  guint cur_freq_value = 0;
+  bool idle = false;        /* whether 'cur_freq_value' was kept because the CPU was idle */
+  guint sampled_sweep = 0;  /* the sweep that last sampled the CPU */
+
+  void close_all ();
+};
+
+/*
+ * The 'scaling_cur_freq' and 'scaling_governor' files are shared by all CPUs of a policy,
+ * so they are read once per policy.
+ */
+struct SysfsPolicyFiles
+{
+  SysfsPolicy policy;
+  int cur_freq = -1;
+  int governor = -1;
+
+  /* The governor is re-read only if it might have changed */
+  bool governor_known = false;
+  GovernorId governor_id = 0;
+  guint governor_events = 0;
+  gint64 governor_read_time = 0;
+
+  void close_all ();
+};
+
+#define URING_MAX_ENTRIES 256
+#define URING_BUF_SIZE    32
+
+/*
+ * The state of the sysfs sweep for a fixed set of CPUs and policies.
+ *
+ * The sweep either runs in a single thread and reads all 'scaling_cur_freq' files
+ * in one io_uring batch, or it is split into chunks of policies that run concurrently
+ * in xfce4::parallelTaskQueue. A chunk accesses only the files of its own policies
+ * and of the CPUs of those policies.
+ *
+ * If the cycle counters can be read via perf events, or the APERF/MPERF counters via
+ * the msr devices, the average effective frequency over the refresh interval is used
+ * instead of 'scaling_cur_freq'.
+ *
+ * Isolated CPUs aren't interrupted unless options->sample_isolated is set: neither their
+ * msr devices nor their policy's 'scaling_cur_freq' are read. Their perf counters
+ * are never opened, since an enabled counter keeps interrupting the CPU.
+ *
+ * If /proc/stat shows that a CPU has been idle since the previous sweep,
+ * its frequency isn't read, so that the CPU isn't woken up, and the last value is kept.
+ *
+ * If CPU hotplug is tracked via uevents, the 'online' files are read only
+ * every ONLINE_REVALIDATE_INTERVAL.
+ * If governor changes are reported via inotify, the 'scaling_governor' files
+ * are read only after a change and every GOVERNOR_REVALIDATE_INTERVAL.
+ * Governors that are only shown in the tooltip are read every GOVERNOR_REVALIDATE_INTERVAL
+ * even without inotify.
+ */
+struct SysfsSampler
+{
+  const std::vector<Ptr<CpuInfo>> cpus;  /* a copy of CpuFreqPlugin::cpus, so that sweeps don't copy it */
+  std::vector<SysfsCpuFiles> files;
+  std::vector<SysfsPolicyFiles> policies;
+  std::vector<size_t> cpu_policy;  /* the index of the policy of each CPU */
+  const bool event_driven;
+  const bool governor_watched;
+
+  /* Cycle counter sampling, if perf events are permitted */
+  Ptr0<CpuFreqPerf> perf;
+
+  /* APERF/MPERF sampling, if the msr devices are accessible */
+  Ptr0<CpuFreqMsr> msr;
 
-static void cpufreq_sysfs_read_string (const std::string &file, std::string &string);
+  /* Idle CPUs of the current sweep, if /proc/stat is readable. Read by the first chunk of the sweep. */
+  Ptr0<CpuFreqStat> stat;
+  std::vector<guint8> idle;
+  std::mutex idle_mutex;
+  guint idle_sweep = 0;  /* 1 + the number of the sweep that read 'idle' */
+
+  /*
+   * Batched reading of the 'scaling_cur_freq' files, if io_uring is available.
+   * Cleared by the sweep if the ring fails, later sweeps then use the thread pool.
+   */
+  std::atomic<bool> batched{false};
+  Ptr0<CpuFreqUring> uring;
+  std::vector<int> uring_fds;
+  std::vector<size_t> uring_policies;  /* the policy of each entry of 'uring_fds' */
+  std::vector<gchar> uring_bufs;
+  std::vector<gssize> uring_results;
+
+  /* Number of policies of the current sweep that have been published */
+  std::atomic<size_t> policies_done{0};
+
+  /* Number of finished sweeps */
+  std::atomic<guint> sweeps{0};
+
+  /* The snapshot published before the last one, reused if nobody else holds it */
+  std::shared_ptr<CpuFreqSnapshot> spare_snapshot;
+
+  SysfsSampler(const std::vector<Ptr<CpuInfo>> &cpus, const std::vector<SysfsPolicy> &policies,
+               bool event_driven, bool governor_watched);
+  ~SysfsSampler();
+};
+
+/*
+ * The part of the sysfs data that the current view needs. Sweeps read only these policies.
+ * A sweep keeps its own reference, so the GUI thread can replace the demand at any time.
+ */
+struct SysfsDemand
+{
+  std::vector<size_t> policies;  /* indices into SysfsSampler::policies */
+  bool governors;                /* whether the governors are displayed by the label or the overview */
+  bool overview;                 /* whether the overview is open */
+  bool isolated;                 /* whether isolated CPUs are sampled */
+  bool affinity;                 /* whether only the CPUs in the process's affinity mask are sampled */
+  std::string cpu_set;           /* options->show_cpu_set, if only the CPUs in the set are sampled */
+  std::vector<guint8> skip;      /* 1 if the CPU isn't sampled */
+
+  /* The view the demand was computed for */
+  gint show_cpu;                 /* a CPU number, or -1 if all CPUs are needed */
+  guint slices;
+  guint slice;
+  guint hot_generation;          /* CpuFreqPlugin::hot.generation, if the hot CPUs were added */
+};
+
+/*
+ * Watches the 'scaling_governor' files using inotify.
+ * Writes to the files by the user, for example via cpupower, are reported as IN_MODIFY.
+ * Changes made by the kernel itself are caught by the periodic revalidation.
+ */
+struct SysfsGovernorWatch
+{
+  int fd = -1;
+  guint source_id = 0;
+
+  ~SysfsGovernorWatch();
+};
+
+/* Accessed from the GUI thread only */
+static std::vector<SysfsPolicy> sysfs_policies;
+static Ptr0<SysfsSampler> sysfs_sampler;
+static std::vector<Ptr<const SysfsDemand>> sysfs_demands;  /* slices computed for 'sysfs_sampler' */
+static std::vector<Ptr0<const SysfsDemand>> sysfs_tiered_demands;  /* per slice, the slice plus the hot CPUs */
+static Ptr0<CpuFreqUevent> sysfs_uevent;
+static Ptr0<SysfsGovernorWatch> sysfs_governor_watch;
+
+/*
+ * The running sweep, set by the GUI thread before it submits the sweep's tasks.
+ * The chunk that finishes the sweep releases the sampler and clears 'running'.
+ */
+struct SysfsSweep
+{
+  Ptr0<SysfsSampler> sampler;
+  Ptr0<const SysfsDemand> demand;
+  std::atomic<bool> running{false};
+};
+static SysfsSweep sysfs_sweep;
+
+/* Incremented in the GUI thread when inotify reports a governor change */
+static std::atomic<guint> sysfs_governor_events(0);
+
+static void cpufreq_sysfs_read_list (const std::string &file, std::vector<guint> &list);
 
 static void cpufreq_sysfs_read_list (const std::string &file, std::vector<std::string> &list);
 
-static void parse_sysfs_init (gint cpu_number, Ptr0<CpuInfo> cpu);
+static void parse_sysfs_init (const std::string &dir, const Ptr<CpuInfo> &cpu);
 
-static gchar* read_file_contents (const std::string &file);
+static void sysfs_copy_init (const CpuInfo &from, CpuInfo &to);
+
+/* A whitespace-separated word in a buffer, not NUL-terminated */
+struct SysfsToken
+{
+  const gchar *data;
+  gsize len;
+};
+
+static gchar* sysfs_read_file (const gchar *file, gchar *buf, gsize size);
+
+static bool sysfs_next_token (const gchar **s, SysfsToken *token);
+
+static guint sysfs_parse_uint (gchar *s);
 
 static bool cpufreq_cpu_exists (gint num);
 
+static gint sysfs_count_cpus ();
+
+static std::vector<SysfsPolicy> sysfs_read_policies (gsize count);
+
+static void sysfs_add_cpus (gsize count);
+
+static void sysfs_init_online ();
+
+static void sysfs_init_isolated ();
+
+static void sysfs_reread_policies (gsize count);
+
+static void sysfs_remove_cpus ();
+
+static void sysfs_handle_uevent (CpuUeventAction action, guint cpu_number);
+
+static Ptr0<SysfsGovernorWatch> sysfs_governor_watch_new ();
+
+static void sysfs_governor_watch_add (SysfsGovernorWatch &watch, const std::string &dir);
+
+static gboolean sysfs_governor_watch_receive (gint fd, GIOCondition condition, gpointer user_data);
+
+static bool open_cached_file (int &fd, const std::string &dir, const gchar *name);
+
+static bool read_cached_file (int &fd, const std::string &dir, const gchar *name, gchar *buf, gsize size);
+
+static Ptr<const SysfsDemand> sysfs_get_demand (const SysfsSampler &sampler);
+
+static void sysfs_read_online (SysfsSampler &sampler, const SysfsDemand &demand, size_t begin, size_t end);
+
+static void sysfs_read_idle (SysfsSampler &sampler, const SysfsDemand &demand);
+
+static bool sysfs_keep_idle_freq (SysfsSampler &sampler, guint cpu);
+
+static bool sysfs_skip_cpu (SysfsSampler &sampler, const SysfsDemand &demand, guint cpu);
+
+static void sysfs_read_cur_freqs (SysfsSampler &sampler, const SysfsDemand &demand, size_t begin, size_t end);
+
+static void sysfs_read_cur_freqs_uring (SysfsSampler &sampler, const SysfsDemand &demand);
+
+static void sysfs_publish (SysfsSampler &sampler, const SysfsDemand &demand, size_t begin, size_t end);
+
+static void sysfs_finish (SysfsSampler &sampler, const SysfsDemand &demand, size_t num_published);
+
 
 
 bool
@@ -62,41 +332,536 @@ cpufreq_sysfs_read_current ()
    */
 
   /* Start a new sysfs-read only if the previous read has finished */
+  if (sysfs_sweep.running)
+    return;
+
+  const std::vector<Ptr<CpuInfo>> &cpus = cpuFreq->cpus;
+  if (cpus.empty())
+    return;
+
+  if (!sysfs_sampler || sysfs_sampler->files.size() != cpus.size())
+  {
+    sysfs_sampler = xfce4::make<SysfsSampler>(cpus, sysfs_policies,
+                                              sysfs_uevent != nullptr, sysfs_governor_watch != nullptr);
+    sysfs_demands.clear();
+    sysfs_tiered_demands.clear();
+  }
+
+  /*
+   * The tasks don't capture anything, so that submitting them doesn't allocate memory.
+   * The queues may still be busy with other work, the sweep waits in line then.
+   */
   xfce4::LaunchConfig config;
-  config.start_if_busy = false;
-
-  const std::vector<Ptr<CpuInfo>> cpus = cpuFreq->cpus;
-  xfce4::singleThreadQueue->start(config, [cpus]() {
-      for (size_t i = 0; i < cpus.size(); i++) {
-        Ptr<CpuInfo> cpu = cpus[i];
-        std::string file;
-
-        /* read current cpu freq */
-        guint cur_freq;
-        file = xfce4::sprintf (SYSFS_BASE "/cpu%zu/cpufreq/scaling_cur_freq", i);
-        cpufreq_sysfs_read_uint (file, &cur_freq);
-
-        /* read current cpu governor */
-        std::string cpu_governor;
-        file = xfce4::sprintf (SYSFS_BASE "/cpu%zu/cpufreq/scaling_governor", i);
-        cpufreq_sysfs_read_string (file, cpu_governor);
-
-        /* read whether the cpu is online, skip first */
-        guint online = 1;
-        if (i != 0)
+  config.start_if_busy = true;
+
+  sysfs_sweep.sampler = sysfs_sampler;
+  sysfs_sweep.demand = sysfs_get_demand (*sysfs_sampler);
+  sysfs_sweep.running = true;
+
+  const size_t num_policies = sysfs_sweep.demand->policies.size();
+  if (sysfs_sampler->batched)
+  {
+    xfce4::singleThreadQueue->start(config, []() {
+        SysfsSampler &sampler = *sysfs_sweep.sampler;
+        const SysfsDemand &demand = *sysfs_sweep.demand;
+        const size_t n = demand.policies.size();
+        sysfs_read_online (sampler, demand, 0, n);
+        sysfs_read_idle (sampler, demand);
+        sysfs_read_cur_freqs_uring (sampler, demand);
+        sysfs_publish (sampler, demand, 0, n);
+        sysfs_finish (sampler, demand, n);
+    });
+  }
+  else if (num_policies == 0)
+  {
+    /* Every CPU is skipped, but a snapshot is still needed to update the plugin */
+    xfce4::parallelTaskQueue->start(config, []() {
+        sysfs_finish (*sysfs_sweep.sampler, *sysfs_sweep.demand, 0);
+    });
+  }
+  else
+  {
+    /* Without io_uring, overlap the waits by reading chunks of policies in multiple threads */
+    xfce4::parallelTaskQueue->start_range(config, num_policies, [](size_t begin, size_t end) {
+        SysfsSampler &sampler = *sysfs_sweep.sampler;
+        const SysfsDemand &demand = *sysfs_sweep.demand;
+        sysfs_read_online (sampler, demand, begin, end);
+        sysfs_read_idle (sampler, demand);
+        sysfs_read_cur_freqs (sampler, demand, begin, end);
+        sysfs_publish (sampler, demand, begin, end);
+        sysfs_finish (sampler, demand, end - begin);
+    });
+  }
+}
+
+
+
+/*
+ * Returns the policies and files the current view needs:
+ * the policy of the displayed CPU, or all policies if the view shows
+ * an aggregate of all CPUs or the overview is open.
+ *
+ * If options->sample_slices is N > 1, aggregates read only every N-th policy per sweep,
+ * rotating with each finished sweep, so that no sample is older than N-1 sweeps.
+ * For min and max, the policies of the CPUs near the displayed extreme
+ * (CpuFreqPlugin::hot) are read in every sweep.
+ *
+ * Isolated CPUs, and in aggregates the CPUs outside of options->show_cpu_set and,
+ * with options->scope_affinity, outside of the process's affinity mask, are skipped. Their policies are read only
+ * if they contain another CPU that is sampled.
+ */
+static Ptr<const SysfsDemand>
+sysfs_get_demand (const SysfsSampler &sampler)
+{
+  auto options = cpuFreq->options;
+
+  if (cpuFreq->cpu_set_count != cpuFreq->cpus.size())
+    cpufreq_update_cpu_set ();
+
+  const bool overview = g_object_get_data (G_OBJECT (cpuFreq->plugin), "overview") != NULL;
+  const gint show_cpu = (options->show_cpu >= 0 && !overview) ? options->show_cpu : -1;
+  const bool governors = options->show_label_governor || overview;
+  const bool isolated = options->sample_isolated;
+  const bool affinity = options->scope_affinity && show_cpu < 0 && !overview;
+  static const std::string no_cpu_set;
+  const std::string &cpu_set = (show_cpu < 0 && !overview) ? options->show_cpu_set : no_cpu_set;
+  const gsize num_policies = sampler.policies.size();
+  const guint slices = (show_cpu < 0 && !overview) ? MAX (1, MIN (options->sample_slices, num_policies)) : 1;
+
+  if (sysfs_demands.empty() || sysfs_demands[0]->show_cpu != show_cpu ||
+      sysfs_demands[0]->governors != governors || sysfs_demands[0]->overview != overview ||
+      sysfs_demands[0]->isolated != isolated ||
+      sysfs_demands[0]->affinity != affinity || sysfs_demands[0]->cpu_set != cpu_set ||
+      sysfs_demands[0]->slices != slices)
+  {
+    const std::vector<Ptr<CpuInfo>> &cpus = cpuFreq->cpus;
+    std::vector<guint8> skip (sampler.files.size(), 0);
+    for (size_t i = 0; i < skip.size() && i < cpus.size(); i++)
+      skip[i] = (cpus[i]->isolated && !isolated) || (!cpus[i]->affine && affinity) ||
+                (!cpu_set.empty() && !cpuFreq->in_cpu_set (i));
+
+    std::vector<size_t> policies;
+    for (size_t p = 0; p < num_policies; p++)
+    {
+      const std::vector<guint> &policy_cpus = sampler.policies[p].policy.cpus;
+      if (std::any_of (policy_cpus.begin(), policy_cpus.end(), [&skip](guint i) { return !skip[i]; }))
+        policies.push_back (p);
+    }
+
+    sysfs_demands.clear();
+    sysfs_tiered_demands.clear();
+    for (guint slice = 0; slice < slices; slice++)
+    {
+      auto demand = xfce4::make<SysfsDemand>();
+      demand->governors = governors;
+      demand->overview = overview;
+      demand->isolated = isolated;
+      demand->affinity = affinity;
+      demand->cpu_set = cpu_set;
+      demand->skip = skip;
+      demand->show_cpu = show_cpu;
+      demand->slices = slices;
+      demand->slice = slice;
+      demand->hot_generation = 0;
+      if (show_cpu >= 0)
+      {
+        if (guint (show_cpu) < sampler.cpu_policy.size())
+          demand->policies.push_back (sampler.cpu_policy[show_cpu]);
+      }
+      else
+      {
+        for (size_t k = slice; k < policies.size(); k += slices)
+          demand->policies.push_back (policies[k]);
+      }
+      sysfs_demands.push_back (demand);
+    }
+
+    /* The first sweep reads all policies, so that every CPU has a sample */
+    if (slices > 1)
+    {
+      auto demand = xfce4::make<SysfsDemand>(*sysfs_demands[0]);
+      demand->policies = policies;
+      sysfs_demands.push_back (demand);
+    }
+  }
+
+  /* A sweep that couldn't start because the previous one is still running doesn't skip a slice */
+  const guint sweeps = sampler.sweeps.load ();
+  if (sweeps == 0)
+    return sysfs_demands.back();
+  const Ptr<const SysfsDemand> &sliced = sysfs_demands[sweeps % slices];
+
+  const auto &hot = cpuFreq->hot;
+  if (slices == 1 || hot.cpus.empty() || (options->show_cpu != CPU_MIN && options->show_cpu != CPU_MAX))
+    return sliced;
+
+  /* Add the policies of the hot CPUs to the slice */
+  if (sysfs_tiered_demands.size() != slices)
+    sysfs_tiered_demands.resize (slices);
+  Ptr0<const SysfsDemand> &tiered = sysfs_tiered_demands[sliced->slice];
+  if (!tiered || tiered->hot_generation != hot.generation)
+  {
+    std::vector<bool> wanted (num_policies, false);
+    for (size_t p : sliced->policies)
+      wanted[p] = true;
+    for (guint i : hot.cpus)
+      if (i < sampler.cpu_policy.size())
+        wanted[sampler.cpu_policy[i]] = true;
+
+    auto demand = xfce4::make<SysfsDemand>(*sliced);
+    demand->hot_generation = hot.generation;
+    demand->policies.clear();
+    for (size_t p = 0; p < num_policies; p++)
+      if (wanted[p])
+        demand->policies.push_back (p);
+    tiered = demand;
+  }
+  return tiered.toPtr();
+}
+
+
+
+static void
+sysfs_read_online (SysfsSampler &sampler, const SysfsDemand &demand, size_t begin, size_t end)
+{
+  const std::vector<Ptr<CpuInfo>> &cpus = sampler.cpus;
+  const gint64 now = g_get_monotonic_time ();
+
+  for (size_t k = begin; k < end; k++)
+  {
+    SysfsPolicyFiles &policy = sampler.policies[demand.policies[k]];
+
+    for (guint i : policy.policy.cpus)
+    {
+      SysfsCpuFiles &files = sampler.files[i];
+      gchar buf[64];
+
+      files.sampled_sweep = sampler.sweeps.load ();
+
+      /* read whether the cpu is online, skip first */
+      guint online = 1;
+      files.online_read = false;
+      if (sampler.event_driven && now - files.online_read_time < ONLINE_REVALIDATE_INTERVAL)
+        online = cpus[i]->load_shared().online;
+      else
+      {
+        files.online_read_time = now;
+        if (i != 0 && read_cached_file (files.online, files.dir, "online", buf, sizeof (buf)))
         {
-          file = xfce4::sprintf (SYSFS_BASE "/cpu%zu/online", i);
-          cpufreq_sysfs_read_uint (file, &online);
+          online = sysfs_parse_uint (buf);
+          files.online_read = true;
         }
+      }
+
+      /* The cpufreq files can disappear and reappear on hotplug */
+      if ((online != 0) != files.was_online)
+      {
+        policy.close_all ();
+        if (sampler.perf)
+          cpufreq_perf_reset (sampler.perf.get(), i);
+        files.was_online = (online != 0);
+      }
+    }
+  }
+}
+
+
+
+/*
+ * Reads /proc/stat once per sweep. The chunks of a sweep that run
+ * in parallel wait for the first one, and then share its result.
+ *
+ * Reading /proc/stat costs more than the single 'scaling_cur_freq' read
+ * it could save, so demands of one policy treat all CPUs as busy.
+ */
+static void
+sysfs_read_idle (SysfsSampler &sampler, const SysfsDemand &demand)
+{
+  if (!sampler.stat)
+    return;
+
+  std::lock_guard<std::mutex> lock (sampler.idle_mutex);
+  const guint sweep = sampler.sweeps.load () + 1;
+  if (sampler.idle_sweep == sweep)
+    return;
+  if (demand.policies.size() <= 1 ||
+      !cpufreq_stat_read_idle (sampler.stat.get(), sampler.idle.data(), sampler.idle.size()))
+    std::fill (sampler.idle.begin(), sampler.idle.end(), 0);
+  sampler.idle_sweep = sweep;
+}
+
+
+
+/*
+ * Returns whether the last frequency of the CPU is kept because the CPU has been idle.
+ * Offline CPUs and CPUs without a frequency yet are never idle.
+ */
+static bool
+sysfs_keep_idle_freq (SysfsSampler &sampler, guint cpu)
+{
+  SysfsCpuFiles &files = sampler.files[cpu];
+  files.idle = !sampler.idle.empty() && sampler.idle[cpu] && files.was_online && files.cur_freq_value != 0;
+  return files.idle;
+}
+
+
+
+/*
+ * Returns whether the CPU isn't sampled at all, see SysfsDemand::skip.
+ */
+static bool
+sysfs_skip_cpu (SysfsSampler &sampler, const SysfsDemand &demand, guint cpu)
+{
+  if (!demand.skip[cpu])
+    return false;
+  SysfsCpuFiles &files = sampler.files[cpu];
+  files.cur_freq_value = 0;
+  files.idle = false;
+  return true;
+}
+
+
+
+static void
+sysfs_read_cur_freqs (SysfsSampler &sampler, const SysfsDemand &demand, size_t begin, size_t end)
+{
+  for (size_t k = begin; k < end; k++)
+  {
+    SysfsPolicyFiles &policy = sampler.policies[demand.policies[k]];
 
+    /* The counters are per CPU, 'scaling_cur_freq' is per policy */
+    bool read_policy = false;
+    for (guint i : policy.policy.cpus)
+    {
+      SysfsCpuFiles &files = sampler.files[i];
+
+      if (sysfs_skip_cpu (sampler, demand, i) || sysfs_keep_idle_freq (sampler, i))
+        continue;
+      files.cur_freq_value = 0;
+      if (!files.was_online)
+        continue;
+
+      /*
+       * Reading the counters of a CPU interrupts it. The perf counters of isolated CPUs
+       * are never opened, their msr devices are read only if isolated CPUs are sampled.
+       */
+      if (sampler.perf && !files.isolated && cpufreq_perf_read_freq (sampler.perf.get(), i, &files.cur_freq_value))
+        continue;
+      if (sampler.msr && (!files.isolated || demand.isolated) &&
+          cpufreq_msr_read_freq (sampler.msr.get(), i, &files.cur_freq_value))
+        continue;
+      read_policy = true;
+    }
+
+    if (read_policy)
+    {
+      gchar buf[64];
+      guint cur_freq = 0;
+      if (read_cached_file (policy.cur_freq, policy.policy.dir, "scaling_cur_freq", buf, sizeof (buf)))
+        cur_freq = sysfs_parse_uint (buf);
+
+      /* Offline CPUs of the policy don't run at the policy's frequency */
+      for (guint i : policy.policy.cpus)
+      {
+        const SysfsCpuFiles &files = sampler.files[i];
+        if (files.cur_freq_value == 0 && files.was_online && !demand.skip[i])
+          sampler.files[i].cur_freq_value = cur_freq;
+      }
+    }
+  }
+}
+
+
+
+/*
+ * Reads the 'scaling_cur_freq' files of the demanded policies concurrently using io_uring.
+ * Files that couldn't be read in the batch are read one by one.
+ * Policies whose online CPUs are all idle aren't read.
+ */
+static void
+sysfs_read_cur_freqs_uring (SysfsSampler &sampler, const SysfsDemand &demand)
+{
+  const gsize count = demand.policies.size();
+
+  if (sampler.uring)
+  {
+    gsize n = 0;
+    for (gsize k = 0; k < count; k++)
+    {
+      SysfsPolicyFiles &policy = sampler.policies[demand.policies[k]];
+
+      bool read_policy = false;
+      for (guint i : policy.policy.cpus)
+      {
+        if (sysfs_skip_cpu (sampler, demand, i))
+          continue;
+        const bool kept = sysfs_keep_idle_freq (sampler, i);
+        if (!sampler.files[i].was_online)
+          sampler.files[i].cur_freq_value = 0;
+        else if (!kept)
+          read_policy = true;
+      }
+      if (!read_policy)
+        continue;
+
+      open_cached_file (policy.cur_freq, policy.policy.dir, "scaling_cur_freq");
+      sampler.uring_fds[n] = policy.cur_freq;
+      sampler.uring_policies[n] = demand.policies[k];
+      n++;
+    }
+
+    if (n == 0 || cpufreq_uring_read (sampler.uring.get(), sampler.uring_fds.data(), n,
+                                      sampler.uring_bufs.data(), URING_BUF_SIZE, sampler.uring_results.data()))
+    {
+      for (gsize k = 0; k < n; k++)
+      {
+        SysfsPolicyFiles &policy = sampler.policies[sampler.uring_policies[k]];
+        gchar buf[64];
+
+        guint cur_freq = 0;
+        if (sampler.uring_results[k] >= 0)
+          cur_freq = sysfs_parse_uint (&sampler.uring_bufs[k * URING_BUF_SIZE]);
+        else if (read_cached_file (policy.cur_freq, policy.policy.dir, "scaling_cur_freq", buf, sizeof (buf)))
+          cur_freq = sysfs_parse_uint (buf);
+
+        for (guint i : policy.policy.cpus)
         {
-            std::lock_guard<std::mutex> guard(cpu->mutex);
-            cpu->shared.cur_freq = cur_freq;
-            cpu->shared.cur_governor = cpu_governor;
-            cpu->shared.online = (online != 0);
+          SysfsCpuFiles &files = sampler.files[i];
+          if (!files.idle && !demand.skip[i])
+            files.cur_freq_value = files.was_online ? cur_freq : 0;
         }
       }
-    });
+      return;
+    }
+
+    /* Read the files one by one in this sweep, and in the thread pool from now on */
+    g_debug ("Reading scaling_cur_freq via io_uring failed, falling back to the thread pool");
+    sampler.uring = nullptr;
+    sampler.batched = false;
+  }
+
+  sysfs_read_cur_freqs (sampler, demand, 0, count);
+}
+
+
+
+static void
+sysfs_publish (SysfsSampler &sampler, const SysfsDemand &demand, size_t begin, size_t end)
+{
+  const std::vector<Ptr<CpuInfo>> &cpus = sampler.cpus;
+
+  for (size_t k = begin; k < end; k++)
+  {
+    SysfsPolicyFiles &policy = sampler.policies[demand.policies[k]];
+    gchar buf[64];
+
+    /*
+     * read current governor of the policy, if it might have changed.
+     * Without inotify, displayed governors are read in every sweep. The tooltip
+     * also shows the governor, so it is revalidated even if not displayed.
+     */
+    const guint events = sysfs_governor_events.load ();
+    const gint64 now = g_get_monotonic_time ();
+    const bool reported = sampler.governor_watched && policy.governor_events != events;
+    const bool expired = !policy.governor_known || now - policy.governor_read_time >= GOVERNOR_REVALIDATE_INTERVAL;
+    bool governor_read = false;
+    if (reported || expired || (demand.governors && !sampler.governor_watched))
+    {
+      const gchar *s = "";
+      SysfsToken governor = { s, 0 };
+      if (read_cached_file (policy.governor, policy.policy.dir, "scaling_governor", buf, sizeof (buf)))
+      {
+        s = buf;
+        sysfs_next_token (&s, &governor);
+      }
+      policy.governor_id = cpufreq_governor_intern (governor.data, governor.len);
+      policy.governor_known = true;
+      policy.governor_events = events;
+      policy.governor_read_time = now;
+      governor_read = true;
+    }
+
+    bool changed = false;
+    for (guint i : policy.policy.cpus)
+    {
+      const SysfsCpuFiles &files = sampler.files[i];
+
+      cpus[i]->update_shared ([&](CpuInfo::Shared &shared) {
+        if (governor_read && shared.cur_governor != policy.governor_id)
+        {
+          shared.cur_governor = policy.governor_id;
+          changed = true;
+        }
+        /* Uevents update 'online' in the main thread, a sweep only overrides it with the file */
+        if ((!sampler.event_driven || files.online_read) && shared.online != files.was_online)
+        {
+          shared.online = files.was_online;
+          changed = true;
+        }
+        shared.cur_freq = files.cur_freq_value;
+      });
+    }
+    if (changed)
+      cpufreq_governor_generation++;
+  }
+}
+
+
+
+/*
+ * Called by each chunk of the sweep after it published its policies.
+ * The chunk that finishes the sweep builds a snapshot of all CPUs and publishes it.
+ */
+static void
+sysfs_finish (SysfsSampler &sampler, const SysfsDemand &demand, size_t num_published)
+{
+  const size_t num_policies = demand.policies.size();
+  if (sampler.policies_done.fetch_add (num_published) + num_published != num_policies)
+    return;
+  sampler.policies_done = 0;
+
+  /* Double buffering: reuse the older snapshot if the main thread is done with it */
+  std::shared_ptr<CpuFreqSnapshot> snapshot = std::move (sampler.spare_snapshot);
+  if (!snapshot || snapshot.use_count() != 1)
+    snapshot = std::make_shared<CpuFreqSnapshot>();
+  else
+    std::atomic_thread_fence (std::memory_order_acquire);
+
+  const guint sweep = sampler.sweeps.load ();
+  const size_t n = sampler.files.size();
+  snapshot->cur_freq.resize (n);
+  snapshot->online.resize (n);
+  snapshot->age.resize (n);
+  snapshot->idle.resize (n);
+
+  {
+    /* The idle states of this sweep, for the CPUs whose policies weren't read */
+    std::lock_guard<std::mutex> lock (sampler.idle_mutex);
+    const bool idle_current = sampler.idle_sweep == sweep + 1 && !sampler.idle.empty();
+
+    for (size_t i = 0; i < n; i++)
+    {
+      const SysfsCpuFiles &files = sampler.files[i];
+      snapshot->cur_freq[i] = files.cur_freq_value;
+      snapshot->online[i] = files.was_online;
+      snapshot->age[i] = sweep - files.sampled_sweep;
+      if (snapshot->age[i] == 0)
+        snapshot->idle[i] = files.idle;
+      else
+        snapshot->idle[i] = idle_current && sampler.idle[i] && files.was_online && files.cur_freq_value != 0;
+    }
+  }
+  snapshot->overview = demand.overview;
+  sampler.sweeps = sweep + 1;
+
+  sampler.spare_snapshot = cpufreq_publish_snapshot (snapshot);
+
+  /*
+   * The sweep is over, the main thread may start the next one and replace the demand.
+   * If it dropped the sampler meanwhile, the last reference goes away after this.
+   */
+  Ptr0<SysfsSampler> keep = std::move (sysfs_sweep.sampler);
+  sysfs_sweep.running = false;
 }
 
 
@@ -104,18 +869,364 @@ cpufreq_sysfs_read_current ()
 bool
 cpufreq_sysfs_read ()
 {
+  gint count = sysfs_count_cpus ();
+  if (count == 0)
+    return false;
+
+  sysfs_policies = sysfs_read_policies (count);
+  sysfs_add_cpus (count);
+
+  /* Track CPU hotplug via uevents instead of reading the 'online' files on every refresh */
+  sysfs_uevent = cpufreq_uevent_new (sysfs_handle_uevent);
+  sysfs_init_online ();
+
+  sysfs_governor_watch = sysfs_governor_watch_new ();
+
+  return true;
+}
+
+
+
+/*
+ * Returns the number of CPUs according to the 'present' list,
+ * or by probing the cpuN directories if the list isn't available.
+ */
+static gint
+sysfs_count_cpus ()
+{
+  gchar buf[SYSFS_BUF_SIZE];
+  const gchar *contents = sysfs_read_file (SYSFS_BASE "/present", buf, sizeof (buf));
+  if (contents)
+  {
+    std::vector<bool> present;
+    if (cpufreq_parse_cpu_list (contents, SYSFS_MAX_CPUS, present))
+    {
+      for (gint count = SYSFS_MAX_CPUS; count > 0; count--)
+        if (present[count - 1])
+          return count;
+    }
+  }
+
   gint count = 0;
   while (cpufreq_cpu_exists (count))
     count++;
+  return count;
+}
 
-  if (count == 0)
-    return false;
 
-  gint i = 0;
-  while (i < count)
-    parse_sysfs_init (i++, nullptr);
 
-  return true;
+/*
+ * Finds the cpufreq policies of CPUs 0..count-1 from the 'related_cpus' files.
+ * A CPU that doesn't belong to any policy directory gets a policy of its own.
+ */
+static std::vector<SysfsPolicy>
+sysfs_read_policies (gsize count)
+{
+  std::vector<SysfsPolicy> policies;
+  std::vector<bool> assigned (count, false);
+
+  GDir *dir = g_dir_open (SYSFS_BASE "/cpufreq", 0, NULL);
+  if (dir)
+  {
+    const gchar *name;
+    while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      if (!g_str_has_prefix (name, "policy"))
+        continue;
+
+      SysfsPolicy policy;
+      policy.dir = xfce4::sprintf ("cpufreq/%s", name);
+
+      std::vector<guint> related_cpus;
+      cpufreq_sysfs_read_list (SYSFS_BASE "/" + policy.dir + "/related_cpus", related_cpus);
+      for (guint cpu : related_cpus)
+      {
+        if (cpu < count && !assigned[cpu])
+        {
+          assigned[cpu] = true;
+          policy.cpus.push_back (cpu);
+        }
+      }
+
+      if (!policy.cpus.empty())
+      {
+        std::sort (policy.cpus.begin(), policy.cpus.end());
+        policies.push_back (policy);
+      }
+    }
+    g_dir_close (dir);
+  }
+
+  for (guint i = 0; i < count; i++)
+  {
+    if (!assigned[i])
+    {
+      SysfsPolicy policy;
+      policy.dir = xfce4::sprintf ("cpu%u/cpufreq", i);
+      policy.cpus.push_back (i);
+      policies.push_back (policy);
+    }
+  }
+
+  std::sort (policies.begin(), policies.end(), [](const SysfsPolicy &a, const SysfsPolicy &b) {
+      return a.cpus[0] < b.cpus[0];
+  });
+
+  return policies;
+}
+
+
+
+/*
+ * Appends CPUs to cpuFreq->cpus until there are 'count' CPUs.
+ * The static data is read once per policy and copied to the other CPUs of the policy.
+ */
+static void
+sysfs_add_cpus (gsize count)
+{
+  std::vector<Ptr<CpuInfo>> &cpus = cpuFreq->cpus;
+  const gsize first = cpus.size();
+  if (first >= count)
+    return;
+
+  for (gsize i = first; i < count; i++)
+    cpus.push_back (xfce4::make<CpuInfo>());
+
+  for (const SysfsPolicy &policy : sysfs_policies)
+  {
+    Ptr0<CpuInfo> source;
+    for (guint i : policy.cpus)
+    {
+      if (i < first)
+      {
+        if (!source)
+          source = cpus[i];
+      }
+      else if (!source)
+      {
+        parse_sysfs_init (policy.dir, cpus[i]);
+        source = cpus[i];
+      }
+      else
+        sysfs_copy_init (*source, *cpus[i]);
+    }
+  }
+
+  sysfs_init_isolated ();
+}
+
+
+
+/*
+ * Initializes the online state of all CPUs from the 'online' list.
+ */
+static void
+sysfs_init_online ()
+{
+  gchar buf[SYSFS_BUF_SIZE];
+  const gchar *contents = sysfs_read_file (SYSFS_BASE "/online", buf, sizeof (buf));
+  if (!contents)
+    return;
+
+  std::vector<bool> is_online;
+  if (!cpufreq_parse_cpu_list (contents, cpuFreq->cpus.size(), is_online))
+    return;
+
+  for (size_t i = 0; i < is_online.size(); i++)
+  {
+    const bool o = is_online[i];
+    cpuFreq->cpus[i]->update_shared ([o](CpuInfo::Shared &shared) { shared.online = o; });
+  }
+
+  cpufreq_governor_generation++;
+}
+
+
+
+/*
+ * Marks the CPUs listed in 'isolated' (isolcpus=) and 'nohz_full' (nohz_full=) as isolated.
+ * Both lists are fixed at boot. 'nohz_full' contains "(null)" on some kernels if it isn't set.
+ */
+static void
+sysfs_init_isolated ()
+{
+  std::vector<Ptr<CpuInfo>> &cpus = cpuFreq->cpus;
+
+  for (const gchar *file : { SYSFS_BASE "/isolated", SYSFS_BASE "/nohz_full" })
+  {
+    gchar buf[SYSFS_BUF_SIZE];
+    const gchar *contents = sysfs_read_file (file, buf, sizeof (buf));
+    if (!contents)
+      continue;
+
+    std::vector<bool> list;
+    if (!cpufreq_parse_cpu_list (contents, cpus.size(), list))
+      continue;
+
+    for (size_t i = 0; i < cpus.size(); i++)
+      if (list[i])
+        cpus[i]->isolated = true;
+  }
+}
+
+
+
+/*
+ * Re-reads the policies of the first 'count' CPUs.
+ * A policy directory is created when the first CPU of the policy comes online.
+ */
+static void
+sysfs_reread_policies (gsize count)
+{
+  std::vector<SysfsPolicy> policies = sysfs_read_policies (count);
+  if (policies != sysfs_policies)
+  {
+    sysfs_policies = policies;
+    sysfs_sampler = nullptr;
+  }
+
+  /* The policy directory of a CPU might have been recreated */
+  if (sysfs_governor_watch)
+    for (const SysfsPolicy &policy : sysfs_policies)
+      sysfs_governor_watch_add (*sysfs_governor_watch, policy.dir);
+}
+
+
+
+/*
+ * Removes the CPUs at the end of CpuFreqPlugin::cpus that no longer exist.
+ */
+static void
+sysfs_remove_cpus ()
+{
+  std::vector<Ptr<CpuInfo>> &cpus = cpuFreq->cpus;
+  while (cpus.size() > 1 && !cpufreq_cpu_exists (cpus.size() - 1))
+    cpus.pop_back();
+  sysfs_policies = sysfs_read_policies (cpus.size());
+  sysfs_sampler = nullptr;
+  cpufreq_governor_generation++;
+}
+
+
+
+/*
+ * Called in the GUI thread when the kernel reports a CPU hotplug event.
+ */
+static void
+sysfs_handle_uevent (CpuUeventAction action, guint cpu_number)
+{
+  if (G_UNLIKELY (cpuFreq == nullptr))
+    return;
+
+  std::vector<Ptr<CpuInfo>> &cpus = cpuFreq->cpus;
+  bool online = false;
+
+  switch (action)
+  {
+  case CPU_UEVENT_ADD:
+    /* An added CPU is usually offline until it is onlined, take its state from sysfs */
+    sysfs_reread_policies (MAX (cpus.size(), cpu_number + 1));
+    if (cpu_number >= cpus.size())
+      sysfs_add_cpus (cpu_number + 1);
+    sysfs_init_online ();
+    return;
+
+  case CPU_UEVENT_ONLINE:
+    sysfs_reread_policies (MAX (cpus.size(), cpu_number + 1));
+    if (cpu_number >= cpus.size())
+      sysfs_add_cpus (cpu_number + 1);
+    online = true;
+    break;
+
+  case CPU_UEVENT_REMOVE:
+    if (cpu_number + 1 == cpus.size())
+    {
+      /* The last CPU has been physically removed */
+      sysfs_remove_cpus ();
+      return;
+    }
+    break;
+
+  case CPU_UEVENT_OFFLINE:
+    break;
+
+  case CPU_UEVENT_OVERRUN:
+  {
+    /* Events were lost: re-read the set of CPUs, the policies and the online states */
+    const gsize count = sysfs_count_cpus ();
+    if (count > cpus.size())
+      sysfs_add_cpus (count);
+    else if (count < cpus.size())
+      sysfs_remove_cpus ();
+    sysfs_reread_policies (cpus.size());
+    sysfs_init_online ();
+    return;
+  }
+  }
+
+  if (cpu_number < cpus.size())
+  {
+    cpus[cpu_number]->update_shared ([online](CpuInfo::Shared &shared) { shared.online = online; });
+    cpufreq_governor_generation++;
+  }
+}
+
+
+
+static Ptr0<SysfsGovernorWatch>
+sysfs_governor_watch_new ()
+{
+  int fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0)
+  {
+    g_debug ("Cannot watch governor changes: %s", g_strerror (errno));
+    return nullptr;
+  }
+
+  auto watch = xfce4::make<SysfsGovernorWatch>();
+  watch->fd = fd;
+  for (const SysfsPolicy &policy : sysfs_policies)
+    sysfs_governor_watch_add (*watch, policy.dir);
+  watch->source_id = g_unix_fd_add (fd, G_IO_IN, sysfs_governor_watch_receive, NULL);
+  return watch;
+}
+
+
+
+/*
+ * Watches the 'scaling_governor' file of the policy.
+ * If the file is already watched, inotify returns the existing watch.
+ */
+static void
+sysfs_governor_watch_add (SysfsGovernorWatch &watch, const std::string &dir)
+{
+  const std::string file = SYSFS_BASE "/" + dir + "/scaling_governor";
+  inotify_add_watch (watch.fd, file.c_str(), IN_MODIFY);
+}
+
+
+
+static gboolean
+sysfs_governor_watch_receive (gint fd, GIOCondition condition, gpointer user_data)
+{
+  /* The events themselves don't matter, all governors are re-read after any change */
+  bool changed = false;
+  gchar buf[4096] __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+  while (true)
+  {
+    ssize_t n = read (fd, buf, sizeof (buf));
+    if (n > 0)
+      changed = true;
+    else if (n < 0 && errno == EINTR)
+      continue;
+    else
+      break;
+  }
+
+  if (changed)
+    sysfs_governor_events++;
+
+  return G_SOURCE_CONTINUE;
 }
 
 
@@ -123,13 +1234,10 @@ cpufreq_sysfs_read ()
 void
 cpufreq_sysfs_read_uint (const std::string &file, guint *intval)
 {
-  gchar *contents = read_file_contents (file);
-  if (contents) {
-    int i = atoi (contents);
-    if (i >= 0)
-      *intval = guint(i);
-    g_free (contents);
-  }
+  gchar buf[64];
+  gchar *contents = sysfs_read_file (file.c_str(), buf, sizeof (buf));
+  if (contents && g_ascii_isdigit (*contents))
+    *intval = sysfs_parse_uint (contents);
 }
 
 
@@ -137,18 +1245,26 @@ cpufreq_sysfs_read_uint (const std::string &file, guint *intval)
 static void
 cpufreq_sysfs_read_list (const std::string &file, std::vector<guint> &list)
 {
-  gchar *contents = read_file_contents (file);
+  gchar buf[SYSFS_BUF_SIZE];
+  gchar *s = sysfs_read_file (file.c_str(), buf, sizeof (buf));
 
-  if (contents) {
-    gchar **tokens = g_strsplit (contents, " ", 0);
-    g_free (contents);
+  if (s) {
     list.clear();
-    for(gint i = 0; tokens[i] != NULL; i++) {
-      gint value = atoi (tokens[i]);
-      if (value >= 0)
-        list.push_back(guint(value));
+    while (*s != '\0') {
+      bool error = true;
+      if (g_ascii_isdigit (*s)) {
+        gulong value = xfce4::parse_ulong (&s, 10, &error);
+        if (!error && value <= G_MAXUINT)
+          list.push_back(guint(value));
+      }
+      if (error) {
+        /* skip the word */
+        while (*s != '\0' && !g_ascii_isspace (*s))
+          s++;
+        while (g_ascii_isspace (*s))
+          s++;
+      }
     }
-    g_strfreev (tokens);
   }
 }
 
@@ -156,11 +1272,10 @@ cpufreq_sysfs_read_list (const std::string &file, std::vector<guint> &list)
 static void
 cpufreq_sysfs_read_string (const std::string &file, std::string &string)
 {
-  gchar *contents = read_file_contents (file);
-  if (contents) {
+  gchar buf[SYSFS_BUF_SIZE];
+  const gchar *contents = sysfs_read_file (file.c_str(), buf, sizeof (buf));
+  if (contents)
     string = contents;
-    g_free (contents);
-  }
 }
 
 
@@ -168,45 +1283,36 @@ cpufreq_sysfs_read_string (const std::string &file, std::string &string)
 static void
 cpufreq_sysfs_read_list (const std::string &file, std::vector<std::string> &list)
 {
-  gchar *contents = read_file_contents (file);
+  gchar buf[SYSFS_BUF_SIZE];
+  const gchar *s = sysfs_read_file (file.c_str(), buf, sizeof (buf));
 
-  if (contents) {
-    gchar **tokens = g_strsplit (contents, " ", 0);
-    g_free (contents);
+  if (s) {
     list.clear();
-    for(gint i = 0; tokens[i] != NULL; i++) {
-      list.push_back(tokens[i]);
-    }
-    g_strfreev (tokens);
+    SysfsToken token;
+    while (sysfs_next_token (&s, &token))
+      list.emplace_back(token.data, token.len);
   }
 }
 
 
 
+/*
+ * Reads the static data of a CPU from the policy directory SYSFS_BASE/dir.
+ */
 static void
-parse_sysfs_init (gint cpu_number, Ptr0<CpuInfo> cpu)
+parse_sysfs_init (const std::string &dir, const Ptr<CpuInfo> &cpu)
 {
-  std::string file;
-  bool add_cpu = false;
-
-  if (cpu == nullptr) {
-    cpu = xfce4::make<CpuInfo>();
-    add_cpu = true;
-  }
+  const std::string base = SYSFS_BASE "/" + dir;
 
   /* read available cpu freqs */
-  if (cpuFreq->intel_pstate == nullptr) {
-    file = xfce4::sprintf (SYSFS_BASE "/cpu%i/cpufreq/scaling_available_frequencies", cpu_number);
-    cpufreq_sysfs_read_list (file, cpu->available_freqs);
-  }
+  if (cpuFreq->intel_pstate == nullptr)
+    cpufreq_sysfs_read_list (base + "/scaling_available_frequencies", cpu->available_freqs);
 
   /* read available cpu governors */
-  file = xfce4::sprintf (SYSFS_BASE "/cpu%i/cpufreq/scaling_available_governors", cpu_number);
-  cpufreq_sysfs_read_list (file, cpu->available_governors);
+  cpufreq_sysfs_read_list (base + "/scaling_available_governors", cpu->available_governors);
 
   /* read cpu driver */
-  file = xfce4::sprintf (SYSFS_BASE "/cpu%i/cpufreq/scaling_driver", cpu_number);
-  cpufreq_sysfs_read_string (file, cpu->scaling_driver);
+  cpufreq_sysfs_read_string (base + "/scaling_driver", cpu->scaling_driver);
 
   /* NOTE: Do NOT read the current CPU frequency here.
    *       Reading all '/sys/.../scaling_cur_freq' files
@@ -215,46 +1321,107 @@ parse_sysfs_init (gint cpu_number, Ptr0<CpuInfo> cpu)
 
   /* read current cpu governor */
   std::string cur_governor;
-  file = xfce4::sprintf (SYSFS_BASE "/cpu%i/cpufreq/scaling_governor", cpu_number);
-  cpufreq_sysfs_read_string (file, cur_governor);
+  cpufreq_sysfs_read_string (base + "/scaling_governor", cur_governor);
 
   /* read max cpu freq */
-  file = xfce4::sprintf (SYSFS_BASE "/cpu%i/cpufreq/scaling_max_freq", cpu_number);
-  cpufreq_sysfs_read_uint (file, &cpu->max_freq_nominal);
+  cpufreq_sysfs_read_uint (base + "/scaling_max_freq", &cpu->max_freq_nominal);
 
   /* read min cpu freq */
-  file = xfce4::sprintf (SYSFS_BASE "/cpu%i/cpufreq/scaling_min_freq", cpu_number);
-  cpufreq_sysfs_read_uint (file, &cpu->min_freq);
+  cpufreq_sysfs_read_uint (base + "/scaling_min_freq", &cpu->min_freq);
 
-  {
-    std::lock_guard<std::mutex> guard(cpu->mutex);
-    cpu->shared.online = true;
-    cpu->shared.cur_freq = 0;
-    cpu->shared.cur_governor = cur_governor;
-  }
+  CpuInfo::Shared shared;
+  shared.online = true;
+  shared.cur_governor = cpufreq_governor_intern (cur_governor);
+  cpu->store_shared (shared);
+}
 
-  if (add_cpu)
-    cpuFreq->cpus.push_back(cpu.toPtr());
+
+
+/*
+ * Copies the static data read by parse_sysfs_init() to another CPU of the same policy.
+ */
+static void
+sysfs_copy_init (const CpuInfo &from, CpuInfo &to)
+{
+  to.available_freqs = from.available_freqs;
+  to.available_governors = from.available_governors;
+  to.scaling_driver = from.scaling_driver;
+  to.max_freq_nominal = from.max_freq_nominal;
+  to.min_freq = from.min_freq;
+
+  CpuInfo::Shared shared;
+  shared.online = true;
+  shared.cur_governor = from.load_shared().cur_governor;
+  to.store_shared (shared);
 }
 
 
 
+/*
+ * Reads a whole sysfs file into buf without allocating memory.
+ * Returns the contents with leading and trailing whitespace removed, or NULL on error.
+ */
 static gchar*
-read_file_contents (const std::string &file)
+sysfs_read_file (const gchar *file, gchar *buf, gsize size)
 {
-  if (!g_file_test (file.c_str(), G_FILE_TEST_EXISTS))
+  int fd = open (file, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
     return NULL;
 
-  GError *error = NULL;
-  gchar *contents = NULL;
-  if (g_file_get_contents (file.c_str(), &contents, NULL, &error)) {
-    g_strstrip (contents);
-    return contents;
+  ssize_t n;
+  do
+    n = read (fd, buf, size - 1);
+  while (n < 0 && errno == EINTR);
+
+  int err = errno;
+  close (fd);
+
+  if (n < 0)
+  {
+    g_debug ("Error reading %s: %s\n", file, g_strerror (err));
+    return NULL;
   }
 
-  g_debug ("Error reading %s: %s\n", file.c_str(), error->message);
-  g_error_free (error);
-  return NULL;
+  buf[n] = '\0';
+  return g_strstrip (buf);
+}
+
+
+
+/*
+ * Finds the next whitespace-separated word in *s and moves *s past it.
+ */
+static bool
+sysfs_next_token (const gchar **s, SysfsToken *token)
+{
+  const gchar *p = *s;
+  while (g_ascii_isspace (*p))
+    p++;
+
+  token->data = p;
+  while (*p != '\0' && !g_ascii_isspace (*p))
+    p++;
+  token->len = p - token->data;
+
+  *s = p;
+  return token->len != 0;
+}
+
+
+
+/*
+ * Parses the unsigned number at the start of s, or returns 0.
+ */
+static guint
+sysfs_parse_uint (gchar *s)
+{
+  while (g_ascii_isspace (*s))
+    s++;
+  if (!g_ascii_isdigit (*s))
+    return 0;
+
+  gulong value = xfce4::parse_ulong (&s, 10);
+  return value <= G_MAXUINT ? guint (value) : 0;
 }
 
 
@@ -267,3 +1434,140 @@ cpufreq_cpu_exists (gint num)
   g_snprintf (file, sizeof (file), SYSFS_BASE "/cpu%d", num);
   return g_file_test (file, G_FILE_TEST_EXISTS);
 }
+
+
+
+/*
+ * Opens the sysfs file SYSFS_BASE/dir/name, unless it is already open.
+ */
+static bool
+open_cached_file (int &fd, const std::string &dir, const gchar *name)
+{
+  if (fd < 0)
+  {
+    gchar file[128];
+    g_snprintf (file, sizeof (file), SYSFS_BASE "/%s/%s", dir.c_str(), name);
+    fd = open (file, O_RDONLY | O_CLOEXEC);
+  }
+  return fd >= 0;
+}
+
+
+
+/*
+ * Reads the sysfs file SYSFS_BASE/dir/name into buf using a cached file descriptor.
+ * The file is opened on first use and reopened if the kernel reports that
+ * the underlying sysfs node has been removed (ENODEV), for example due to CPU hotplug.
+ */
+static bool
+read_cached_file (int &fd, const std::string &dir, const gchar *name, gchar *buf, gsize size)
+{
+  for (int attempt = 0; attempt < 2; attempt++)
+  {
+    if (!open_cached_file (fd, dir, name))
+      return false;
+
+    ssize_t n = pread (fd, buf, size - 1, 0);
+    if (G_LIKELY (n >= 0))
+    {
+      buf[n] = '\0';
+      return true;
+    }
+
+    int err = errno;
+    close (fd);
+    fd = -1;
+    if (err != ENODEV)
+      return false;
+  }
+
+  return false;
+}
+
+
+
+void
+SysfsCpuFiles::close_all ()
+{
+  if (online >= 0)
+  {
+    close (online);
+    online = -1;
+  }
+}
+
+void
+SysfsPolicyFiles::close_all ()
+{
+  if (cur_freq >= 0)
+  {
+    close (cur_freq);
+    cur_freq = -1;
+  }
+  if (governor >= 0)
+  {
+    close (governor);
+    governor = -1;
+  }
+  governor_known = false;
+}
+
+SysfsSampler::SysfsSampler(const std::vector<Ptr<CpuInfo>> &_cpus, const std::vector<SysfsPolicy> &_policies,
+                           bool _event_driven, bool _governor_watched) :
+  cpus(_cpus), files(_cpus.size()), policies(_policies.size()), cpu_policy(_cpus.size()),
+  event_driven(_event_driven), governor_watched(_governor_watched)
+{
+  const size_t count = cpus.size();
+  std::vector<bool> isolated(count);
+  for (size_t i = 0; i < count; i++)
+  {
+    files[i].dir = xfce4::sprintf ("cpu%zu", i);
+    files[i].isolated = isolated[i] = cpus[i]->isolated;
+  }
+  for (size_t p = 0; p < _policies.size(); p++)
+  {
+    policies[p].policy = _policies[p];
+    for (guint i : _policies[p].cpus)
+      if (i < count)
+        cpu_policy[i] = p;
+  }
+
+  stat = cpufreq_stat_new (count);
+  if (stat)
+    idle.resize (count);
+
+  perf = cpufreq_perf_new (isolated);
+  if (perf)
+    return;
+
+  msr = cpufreq_msr_new (MSR_BASE, isolated);
+  if (msr)
+    return;
+
+  const size_t num_policies = policies.size();
+  uring = cpufreq_uring_new (CLAMP (num_policies, 1, URING_MAX_ENTRIES));
+  if (uring)
+  {
+    batched = true;
+    uring_fds.resize (num_policies);
+    uring_policies.resize (num_policies);
+    uring_bufs.resize (num_policies * URING_BUF_SIZE);
+    uring_results.resize (num_policies);
+  }
+}
+
+SysfsSampler::~SysfsSampler()
+{
+  for (SysfsCpuFiles &f : files)
+    f.close_all ();
+  for (SysfsPolicyFiles &p : policies)
+    p.close_all ();
+}
+
+SysfsGovernorWatch::~SysfsGovernorWatch()
+{
+  if (source_id != 0)
+    g_source_remove (source_id);
+  if (fd >= 0)
+    close (fd);
+}
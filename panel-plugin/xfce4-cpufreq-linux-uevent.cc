@@ -0,0 +1,198 @@
+/*  xfce4-cpu-freq-plugin - panel plugin for cpu informations
+ *
+ *  Copyright (c) 2026 The Xfce development team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <errno.h>
+#include <glib-unix.h>
+#include <linux/netlink.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "xfce4-cpufreq-linux-uevent.h"
+
+#define UEVENT_BUF_SIZE 4096
+
+struct CpuFreqUevent
+{
+  int fd = -1;
+  guint source_id = 0;
+  CpuUeventHandler handler;
+
+  ~CpuFreqUevent();
+};
+
+static gboolean uevent_receive (gint fd, GIOCondition condition, gpointer user_data);
+
+
+
+xfce4::Ptr0<CpuFreqUevent>
+cpufreq_uevent_new (const CpuUeventHandler &handler)
+{
+  int fd = socket (AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+  if (fd < 0)
+  {
+    g_debug ("Cannot open uevent socket: %s", g_strerror (errno));
+    return nullptr;
+  }
+
+  /* Multicast group 1 receives the kernel's uevents (udev re-broadcasts to group 2) */
+  struct sockaddr_nl addr = {};
+  addr.nl_family = AF_NETLINK;
+  addr.nl_groups = 1;
+  if (bind (fd, (struct sockaddr*) &addr, sizeof (addr)) != 0)
+  {
+    g_debug ("Cannot bind uevent socket: %s", g_strerror (errno));
+    close (fd);
+    return nullptr;
+  }
+
+  return cpufreq_uevent_new_from_fd (fd, handler);
+}
+
+
+
+xfce4::Ptr0<CpuFreqUevent>
+cpufreq_uevent_new_from_fd (int fd, const CpuUeventHandler &handler)
+{
+  auto uevent = xfce4::make<CpuFreqUevent>();
+  uevent->fd = fd;
+  uevent->handler = handler;
+  uevent->source_id = g_unix_fd_add (fd, G_IO_IN, uevent_receive, &*uevent);
+  return uevent;
+}
+
+
+
+bool
+cpufreq_uevent_parse (const gchar *msg, gsize len, CpuUeventAction *action, guint *cpu)
+{
+  /* The header "ACTION@DEVPATH" is followed by the same data as KEY=VALUE pairs */
+  /* All fields have to be terminated within the message */
+  if (len == 0 || msg[len - 1] != '\0')
+    return false;
+
+  const gchar *const end = msg + len;
+  const gchar *action_str = NULL, *devpath = NULL, *subsystem = NULL;
+
+  for (const gchar *p = msg; p < end; p += strnlen (p, end - p) + 1)
+  {
+    if (g_str_has_prefix (p, "ACTION="))
+      action_str = p + strlen ("ACTION=");
+    else if (g_str_has_prefix (p, "DEVPATH="))
+      devpath = p + strlen ("DEVPATH=");
+    else if (g_str_has_prefix (p, "SUBSYSTEM="))
+      subsystem = p + strlen ("SUBSYSTEM=");
+  }
+
+  if (!action_str || !devpath || !subsystem || strcmp (subsystem, "cpu") != 0)
+    return false;
+
+  if (!g_str_has_prefix (devpath, "/devices/system/cpu/cpu"))
+    return false;
+
+  const gchar *num = devpath + strlen ("/devices/system/cpu/cpu");
+  if (!g_ascii_isdigit (*num))
+    return false;
+
+  gchar *num_end;
+  guint64 n = g_ascii_strtoull (num, &num_end, 10);
+  if (*num_end != '\0' || n > G_MAXINT)
+    return false;
+
+  if (strcmp (action_str, "add") == 0)
+    *action = CPU_UEVENT_ADD;
+  else if (strcmp (action_str, "remove") == 0)
+    *action = CPU_UEVENT_REMOVE;
+  else if (strcmp (action_str, "online") == 0)
+    *action = CPU_UEVENT_ONLINE;
+  else if (strcmp (action_str, "offline") == 0)
+    *action = CPU_UEVENT_OFFLINE;
+  else
+    return false;
+
+  *cpu = guint (n);
+  return true;
+}
+
+
+
+static gboolean
+uevent_receive (gint fd, GIOCondition condition, gpointer user_data)
+{
+  auto uevent = (CpuFreqUevent*) user_data;
+
+  /* Drain the socket, a hotplug of many CPUs can queue many messages */
+  bool overrun = false;
+  while (true)
+  {
+    gchar buf[UEVENT_BUF_SIZE];
+    struct sockaddr_nl addr = {};
+    struct iovec iov = { buf, sizeof (buf) - 1 };
+    struct msghdr hdr = {};
+    hdr.msg_name = &addr;
+    hdr.msg_namelen = sizeof (addr);
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+
+    ssize_t n = recvmsg (fd, &hdr, 0);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        break;
+      if (errno == ENOBUFS)
+      {
+        /* Messages were lost, the handler resyncs after the socket has been drained */
+        g_debug ("uevent socket overrun");
+        overrun = true;
+        continue;
+      }
+      g_debug ("uevent socket error: %s", g_strerror (errno));
+      uevent->source_id = 0;
+      return G_SOURCE_REMOVE;
+    }
+
+    /* Only accept messages sent by the kernel */
+    if (hdr.msg_namelen == sizeof (addr) && addr.nl_pid != 0)
+      continue;
+
+    buf[n] = '\0';
+
+    CpuUeventAction action;
+    guint cpu;
+    if (cpufreq_uevent_parse (buf, n + 1, &action, &cpu))
+      uevent->handler (action, cpu);
+  }
+
+  if (overrun)
+    uevent->handler (CPU_UEVENT_OVERRUN, 0);
+
+  return G_SOURCE_CONTINUE;
+}
+
+
+
+CpuFreqUevent::~CpuFreqUevent()
+{
+  if (source_id != 0)
+    g_source_remove (source_id);
+  if (fd >= 0)
+    close (fd);
+}
@@ -0,0 +1,60 @@
+/*  xfce4-cpu-freq-plugin - panel plugin for cpu informations
+ *
+ *  Copyright (c) 2026 The Xfce development team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef XFCE4_CPUFREQ_LINUX_UEVENT_H
+#define XFCE4_CPUFREQ_LINUX_UEVENT_H
+
+#include <functional>
+#include <glib.h>
+#include "xfce4++/util.h"
+
+enum CpuUeventAction
+{
+  CPU_UEVENT_ADD,
+  CPU_UEVENT_REMOVE,
+  CPU_UEVENT_ONLINE,
+  CPU_UEVENT_OFFLINE,
+  CPU_UEVENT_OVERRUN,  /* events were lost, the 'cpu' argument is meaningless */
+};
+
+typedef std::function<void (CpuUeventAction action, guint cpu)> CpuUeventHandler;
+
+struct CpuFreqUevent;
+
+/*
+ * Listens for kernel uevents of the 'cpu' subsystem in the GLib main loop.
+ * The handler is called in the main thread. If the socket overran,
+ * the handler is called with CPU_UEVENT_OVERRUN and has to resynchronize.
+ * Returns nullptr if the NETLINK_KOBJECT_UEVENT socket cannot be opened.
+ */
+xfce4::Ptr0<CpuFreqUevent> cpufreq_uevent_new (const CpuUeventHandler &handler);
+
+/*
+ * Same as cpufreq_uevent_new(), but receives the uevent messages from an already open
+ * datagram socket, for example from one end of a socketpair. Takes ownership of fd.
+ */
+xfce4::Ptr0<CpuFreqUevent> cpufreq_uevent_new_from_fd (int fd, const CpuUeventHandler &handler);
+
+/*
+ * Parses a kernel uevent message of the form "ACTION@DEVPATH\0KEY=VALUE\0...".
+ * Returns false if the message isn't about a CPU in /devices/system/cpu.
+ */
+bool cpufreq_uevent_parse (const gchar *msg, gsize len, CpuUeventAction *action, guint *cpu);
+
+#endif /* XFCE4_CPUFREQ_LINUX_UEVENT_H */
@@ -0,0 +1,186 @@
+/*  xfce4-cpu-freq-plugin - panel plugin for cpu informations
+ *
+ *  Copyright (c) 2026 The Xfce development team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Reading a 'scaling_cur_freq' file blocks until the kernel gets an answer
+ * from the target CPU core. When the files of all CPUs are read one after
+ * another, these waits add up. io_uring allows to submit the reads of all
+ * files at once: the kernel executes them in its worker threads concurrently
+ * and the waits overlap.
+ */
+
+#include <errno.h>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "xfce4-cpufreq-linux-uring.h"
+
+struct CpuFreqUring
+{
+#ifdef HAVE_LIBURING
+  struct io_uring ring;
+  guint entries = 0;
+
+  ~CpuFreqUring();
+#endif
+};
+
+
+
+#ifdef HAVE_LIBURING
+
+CpuFreqUring::~CpuFreqUring()
+{
+  if (entries != 0)
+    io_uring_queue_exit (&ring);
+}
+
+
+
+xfce4::Ptr0<CpuFreqUring>
+cpufreq_uring_new (guint entries)
+{
+  auto uring = xfce4::make<CpuFreqUring>();
+
+  int ret = io_uring_queue_init (entries, &uring->ring, 0);
+  if (ret < 0)
+  {
+    g_debug ("io_uring is not available: %s", g_strerror (-ret));
+    return nullptr;
+  }
+
+  uring->entries = entries;
+  return uring;
+}
+
+
+
+bool
+cpufreq_uring_read (CpuFreqUring *uring, const int *fds, gsize count,
+                    gchar *bufs, gsize buf_size, gssize *results)
+{
+  gsize i = 0;
+  while (i < count)
+  {
+    /* Fill the submission queue */
+    guint submitted = 0;
+    for (; i < count && submitted < uring->entries; i++)
+    {
+      if (fds[i] < 0)
+      {
+        results[i] = -EBADF;
+        continue;
+      }
+
+      struct io_uring_sqe *sqe = io_uring_get_sqe (&uring->ring);
+      if (G_UNLIKELY (sqe == NULL))
+        break;
+
+      io_uring_prep_read (sqe, fds[i], bufs + i * buf_size, buf_size - 1, 0);
+      /* Punt the read to a kernel worker thread so that the reads run concurrently */
+      io_uring_sqe_set_flags (sqe, IOSQE_ASYNC);
+      io_uring_sqe_set_data64 (sqe, i);
+      submitted++;
+    }
+
+    if (submitted == 0)
+    {
+      /* No entry could be queued, the caller reads the files one by one instead */
+      if (i < count)
+        return false;
+      continue;
+    }
+
+    const int ret = io_uring_submit_and_wait (&uring->ring, submitted);
+    if (G_UNLIKELY (ret < 0))
+    {
+      g_debug ("io_uring_submit_and_wait: %s", g_strerror (-ret));
+      return false;
+    }
+
+    /* Reap the completions of the entries the kernel actually consumed */
+    const guint consumed = guint (ret);
+    guint reaped = 0;
+    while (reaped < consumed)
+    {
+      struct io_uring_cqe *cqes[64];
+      guint n = io_uring_peek_batch_cqe (&uring->ring, cqes, MIN (consumed - reaped, G_N_ELEMENTS (cqes)));
+      if (n == 0)
+      {
+        struct io_uring_cqe *cqe;
+        int err = io_uring_wait_cqe (&uring->ring, &cqe);
+        if (G_UNLIKELY (err < 0))
+        {
+          g_debug ("io_uring_wait_cqe: %s", g_strerror (-err));
+          return false;
+        }
+        continue;
+      }
+
+      for (guint j = 0; j < n; j++)
+      {
+        const gsize index = io_uring_cqe_get_data64 (cqes[j]);
+        const int res = cqes[j]->res;
+
+        /* At most buf_size-1 bytes were requested */
+        if (res >= 0 && gsize (res) < buf_size)
+        {
+          results[index] = res;
+          bufs[index * buf_size + res] = '\0';
+        }
+        else
+        {
+          results[index] = res < 0 ? res : -EIO;
+        }
+      }
+      io_uring_cq_advance (&uring->ring, n);
+      reaped += n;
+    }
+
+    /* The remaining entries are still queued, so the ring can't be used for another batch */
+    if (G_UNLIKELY (consumed < submitted))
+    {
+      g_debug ("io_uring_submit_and_wait: only %u of %u entries submitted", consumed, submitted);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+#else /* !HAVE_LIBURING */
+
+xfce4::Ptr0<CpuFreqUring>
+cpufreq_uring_new (guint entries)
+{
+  return nullptr;
+}
+
+
+
+bool
+cpufreq_uring_read (CpuFreqUring *uring, const int *fds, gsize count,
+                    gchar *bufs, gsize buf_size, gssize *results)
+{
+  return false;
+}
+
+#endif /* !HAVE_LIBURING */
@@ -0,0 +1,46 @@
+/*  xfce4-cpu-freq-plugin - panel plugin for cpu informations
+ *
+ *  Copyright (c) 2026 The Xfce development team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef XFCE4_CPUFREQ_LINUX_URING_H
+#define XFCE4_CPUFREQ_LINUX_URING_H
+
+#include <glib.h>
+#include "xfce4++/util.h"
+
+struct CpuFreqUring;
+
+/*
+ * Creates an io_uring instance with the specified number of entries.
+ * Returns nullptr if io_uring support wasn't compiled in or isn't available at runtime.
+ */
+xfce4::Ptr0<CpuFreqUring> cpufreq_uring_new (guint entries);
+
+/*
+ * Reads the files fds[0..count-1] at offset 0 into bufs, all at once.
+ *
+ * The i-th file is read into bufs[i*buf_size] and is NUL-terminated.
+ * results[i] is set to the number of bytes read, or to a negative errno value.
+ * Entries with a negative file descriptor are skipped.
+ *
+ * Returns false if the reads couldn't be submitted. The ring is unusable afterwards.
+ */
+bool cpufreq_uring_read (CpuFreqUring *uring, const int *fds, gsize count,
+                         gchar *bufs, gsize buf_size, gssize *results);
+
+#endif /* XFCE4_CPUFREQ_LINUX_URING_H */
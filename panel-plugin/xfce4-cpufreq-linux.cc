@@ -21,7 +21,9 @@
  */
 
 #include <dirent.h>
+#include <errno.h>
 #include <math.h>
+#include <sched.h>
 #include <stdlib.h>
 
 #include <libxfce4ui/libxfce4ui.h>
@@ -31,11 +33,35 @@
 #include "xfce4-cpufreq-linux-procfs.h"
 #include "xfce4-cpufreq-linux-pstate.h"
 #include "xfce4-cpufreq-linux-sysfs.h"
+#include "xfce4-cpufreq-overview.h"
+
+/* The latest snapshot, accessed only via std::atomic_load() and std::atomic_exchange() */
+static std::shared_ptr<CpuFreqSnapshot> linux_snapshot;
+
+/* Hands the latest snapshot over to the main thread, created once and kept */
+static Ptr0<xfce4::Wakeup> linux_snapshot_wakeup;
+
+static bool cpufreq_linux_init_backend ();
+
+static void cpufreq_snapshot_ready ();
+
+static void cpufreq_update_samples (const CpuFreqSnapshot *snapshot);
 
 
 
 bool
 cpufreq_linux_init ()
+{
+  if (!linux_snapshot_wakeup)
+    linux_snapshot_wakeup = xfce4::make<xfce4::Wakeup>(cpufreq_snapshot_ready);
+
+  return cpufreq_linux_init_backend ();
+}
+
+
+
+static bool
+cpufreq_linux_init_backend ()
 {
   if (cpufreq_sysfs_is_available ())
     return cpufreq_sysfs_read ();
@@ -83,30 +109,94 @@ cpufreq_update_cpus ()
 
   if (cpufreq_sysfs_is_available ())
   {
+    /* The plugin is updated when the sweep publishes its snapshot */
     cpufreq_sysfs_read_current ();
   }
   else if (cpufreq_procfs_is_available ())
   {
-    /* First we delete the cpus and then read the /proc/cpufreq file again */
-    cpuFreq->cpus.clear();
     cpufreq_procfs_read ();
+    cpufreq_update_samples (nullptr);
   }
   else
   {
-    /* We do not need to update, because no scaling available */
-    return;
+    /* No scaling available, but the current frequency is in /proc/cpuinfo */
+    cpufreq_procfs_read_cpuinfo_current ([]() {
+      if (G_LIKELY (cpuFreq != nullptr))
+        cpufreq_update_samples (nullptr);
+    });
   }
+}
 
-  for (const Ptr<CpuInfo> &cpu : cpuFreq->cpus)
+
+
+void
+cpufreq_linux_read_affinity ()
+{
+  const std::vector<Ptr<CpuInfo>> &cpus = cpuFreq->cpus;
+  if (cpus.empty())
+    return;
+
+  cpu_set_t *set = CPU_ALLOC (cpus.size());
+  if (G_UNLIKELY (set == NULL))
+    return;
+  const gsize size = CPU_ALLOC_SIZE (cpus.size());
+
+  if (sched_getaffinity (0, size, set) == 0)
   {
-    guint cur_freq;
-    {
-      std::lock_guard<std::mutex> guard(cpu->mutex);
-      cur_freq = cpu->shared.cur_freq;
-    }
+    for (size_t i = 0; i < cpus.size(); i++)
+      cpus[i]->affine = CPU_ISSET_S (i, size, set);
+  }
+  else
+  {
+    g_debug ("sched_getaffinity: %s", g_strerror (errno));
+    for (const Ptr<CpuInfo> &cpu : cpus)
+      cpu->affine = true;
+  }
+
+  CPU_FREE (set);
+}
 
-    cpu->max_freq_measured = MAX (cpu->max_freq_measured, cur_freq);
 
+
+std::shared_ptr<CpuFreqSnapshot>
+cpufreq_publish_snapshot (const std::shared_ptr<CpuFreqSnapshot> &snapshot)
+{
+  std::shared_ptr<CpuFreqSnapshot> previous = std::atomic_exchange (&linux_snapshot, snapshot);
+
+  /* Wake up the main loop, a pending wakeup displays this snapshot too */
+  linux_snapshot_wakeup->trigger ();
+
+  return previous;
+}
+
+
+
+static void
+cpufreq_snapshot_ready ()
+{
+  if (G_UNLIKELY (cpuFreq == nullptr))
+    return;
+
+  const std::shared_ptr<const CpuFreqSnapshot> latest = std::atomic_load (&linux_snapshot);
+  cpufreq_update_samples (latest.get());
+}
+
+
+
+static void
+cpufreq_update_samples (const CpuFreqSnapshot *snapshot)
+{
+  cpufreq_gather_samples (snapshot);
+  cpufreq_adapt_timeout ();
+
+  const CpuFreqSamples &samples = cpuFreq->samples;
+  for (size_t i = 0; i < samples.size(); i++)
+  {
+    /* Samples kept from earlier sweeps have been counted already */
+    if (samples.age[i] != 0)
+      continue;
+
+    const guint cur_freq = samples.cur_freq[i];
     gint bin = round ((cur_freq - FREQ_HIST_MIN) * ((gdouble) FREQ_HIST_BINS / (FREQ_HIST_MAX - FREQ_HIST_MIN)));
     if (G_UNLIKELY (bin < 0))
       bin = 0;
@@ -123,4 +213,7 @@ cpufreq_update_cpus ()
   }
 
   cpufreq_update_plugin (false);
+
+  if (snapshot != nullptr && snapshot->overview)
+    cpufreq_overview_refresh ();
 }
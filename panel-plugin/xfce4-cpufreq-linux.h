@@ -22,11 +22,31 @@
 #define XFCE4_CPUFREQ_LINUX_H
 
 #include <glib.h>
+#include <memory>
+
+struct CpuFreqSnapshot;
 
 void
 cpufreq_update_cpus ();
 
+/*
+ * Publishes a complete sampling sweep and wakes up the main loop to display it.
+ * Can be called from any thread.
+ *
+ * Returns the previously published snapshot. The caller can reuse it for a later sweep
+ * once it holds the only reference to it.
+ */
+std::shared_ptr<CpuFreqSnapshot>
+cpufreq_publish_snapshot (const std::shared_ptr<CpuFreqSnapshot> &snapshot);
+
 bool
 cpufreq_linux_init ();
 
+/*
+ * Sets CpuInfo::affine of all CPUs from the affinity mask of the process.
+ * The mask already excludes the CPUs outside of the process's cgroup cpuset.
+ */
+void
+cpufreq_linux_read_affinity ();
+
 #endif /* XFCE4_CPUFREQ_LINUX_H */
@@ -40,12 +40,9 @@ cpufreq_overview_add (const Ptr<const CpuInfo> &cpu, guint cpu_number, GtkWidget
   GtkWidget *hbox, *label;
   const CpuFreqUnit unit = cpuFreq->options->unit;
 
-  /* Copy shared fields to a local variable. The local variable can then be accessed without a mutex. */
-  CpuInfo::Shared cpu_shared;
-  {
-      std::lock_guard<std::mutex> guard(cpu->mutex);
-      cpu_shared = cpu->shared;
-  }
+  /* Take a snapshot of the shared fields */
+  const CpuInfo::Shared cpu_shared = cpu->load_shared();
+  const std::string &cur_governor = cpufreq_governor_name (cpu_shared.cur_governor);
 
   GtkWidget *dialog_vbox = gtk_box_new (GTK_ORIENTATION_VERTICAL, BORDER);
   gtk_widget_set_sensitive (dialog_vbox, cpu_shared.online);
@@ -63,7 +60,10 @@ cpufreq_overview_add (const Ptr<const CpuInfo> &cpu, guint cpu_number, GtkWidget
   gtk_widget_set_margin_end (icon, 5);
 
   gtk_box_pack_start (GTK_BOX (hbox), icon, true, true, 0);
-  label = gtk_label_new (xfce4::sprintf ("<b>CPU %u</b>", cpu_number).c_str());
+  std::string title = xfce4::sprintf ("<b>CPU %u</b>", cpu_number);
+  if (cpu->isolated)
+    title += xfce4::sprintf (" <i>%s</i>", _("isolated"));
+  label = gtk_label_new (title.c_str());
   gtk_widget_set_valign (label, GTK_ALIGN_CENTER);
   gtk_label_set_xalign (GTK_LABEL (label), 0);
   gtk_box_pack_start (GTK_BOX (hbox), label, true, true, 0);
@@ -175,13 +175,13 @@ cpufreq_overview_add (const Ptr<const CpuInfo> &cpu, guint cpu_number, GtkWidget
       const std::string &available_governor = cpu->available_governors[j];
       gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT (combo), available_governor.c_str());
 
-      if (g_ascii_strcasecmp (available_governor.c_str(), cpu_shared.cur_governor.c_str()) == 0)
+      if (g_ascii_strcasecmp (available_governor.c_str(), cur_governor.c_str()) == 0)
         i = j;
     }
 
     gtk_combo_box_set_active (GTK_COMBO_BOX (combo), i);
   }
-  else if (!cpu_shared.cur_governor.empty()) /* Linux 2.4 and cpu scaling support */
+  else if (!cur_governor.empty()) /* Linux 2.4 and cpu scaling support */
   {
     hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, BORDER);
     gtk_box_pack_start (GTK_BOX (dialog_vbox), hbox, false, false, 0);
@@ -192,8 +192,8 @@ cpufreq_overview_add (const Ptr<const CpuInfo> &cpu, guint cpu_number, GtkWidget
     gtk_label_set_xalign (GTK_LABEL (label), 0);
     gtk_box_pack_start (GTK_BOX (hbox), label, true, true, 0);
 
-    std::string cur_governor = "<b>" + cpu_shared.cur_governor + "</b>";
-    label = gtk_label_new (cur_governor.c_str());
+    std::string cur_governor_markup = "<b>" + cur_governor + "</b>";
+    label = gtk_label_new (cur_governor_markup.c_str());
     gtk_size_group_add_widget (sg1, label);
     gtk_widget_set_valign (label, GTK_ALIGN_CENTER);
     gtk_label_set_xalign (GTK_LABEL (label), 0);
@@ -209,6 +209,52 @@ cpufreq_overview_add (const Ptr<const CpuInfo> &cpu, guint cpu_number, GtkWidget
 
 
 
+static void
+cpufreq_overview_fill (GtkWidget *scrolled_window)
+{
+  GtkWidget *child = gtk_bin_get_child (GTK_BIN (scrolled_window));
+  if (child)
+    gtk_widget_destroy (child);
+
+  /* choose how many columns and rows depending on cpu count */
+  size_t step;
+  if (cpuFreq->cpus.size() < 4)
+    step = 1;
+  else if (cpuFreq->cpus.size() < 9)
+    step = 2;
+  else if (cpuFreq->cpus.size() % 3 != 0)
+    step = 4;
+  else
+    step = 3;
+
+  GtkWidget *cpu_info_box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+
+  for (size_t i = 0; i < cpuFreq->cpus.size(); i += step) {
+    GtkWidget *dialog_hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, BORDER * 2);
+    gtk_box_pack_start (GTK_BOX (cpu_info_box), dialog_hbox, false, false, BORDER * 2);
+    gtk_container_set_border_width (GTK_CONTAINER (dialog_hbox), BORDER * 2);
+
+    for (size_t j = i; j < cpuFreq->cpus.size() && j < i + step; j++) {
+      Ptr<const CpuInfo> cpu = cpuFreq->cpus[j];
+      cpufreq_overview_add (cpu, j, dialog_hbox);
+
+      if (j + 1 < cpuFreq->cpus.size() && j + 1 == i + step) {
+        GtkWidget *separator = gtk_separator_new (GTK_ORIENTATION_HORIZONTAL);
+        gtk_box_pack_start (GTK_BOX (cpu_info_box), separator, false, false, 0);
+      }
+
+      if (j + 1 < cpuFreq->cpus.size() && j + 1 < i + step) {
+        GtkWidget *separator = gtk_separator_new (GTK_ORIENTATION_VERTICAL);
+        gtk_box_pack_start (GTK_BOX (dialog_hbox), separator, false, false, 0);
+      }
+    }
+  }
+
+  gtk_container_add (GTK_CONTAINER (scrolled_window), cpu_info_box);
+}
+
+
+
 static void
 cpufreq_overview_response (GtkDialog *dialog, gint response)
 {
@@ -252,52 +298,44 @@ cpufreq_overview (GdkEventButton *ev)
 
   GtkWidget *dialog_vbox = gtk_dialog_get_content_area (GTK_DIALOG (dialog));
 
-  /* choose how many columns and rows depending on cpu count */
-  size_t step;
-  if (cpuFreq->cpus.size() < 4)
-    step = 1;
-  else if (cpuFreq->cpus.size() < 9)
-    step = 2;
-  else if (cpuFreq->cpus.size() % 3 != 0)
-    step = 4;
-  else
-    step = 3;
-
   GtkWidget *scrolled_window = gtk_scrolled_window_new (NULL, NULL);
   gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scrolled_window),
                                   GTK_POLICY_NEVER,
                                   GTK_POLICY_AUTOMATIC);
   gtk_scrolled_window_set_min_content_height (GTK_SCROLLED_WINDOW (scrolled_window), 300);
 
-  GtkWidget *cpu_info_box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+  cpufreq_overview_fill (scrolled_window);
+  gtk_box_pack_start (GTK_BOX (dialog_vbox), scrolled_window, true, true, 0);
 
-  for (size_t i = 0; i < cpuFreq->cpus.size(); i += step) {
-    GtkWidget *dialog_hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, BORDER * 2);
-    gtk_box_pack_start (GTK_BOX (cpu_info_box), dialog_hbox, false, false, BORDER * 2);
-    gtk_container_set_border_width (GTK_CONTAINER (dialog_hbox), BORDER * 2);
+  /* Rebuild the overview after the next sweep */
+  g_object_set_data (G_OBJECT (dialog), "stale", scrolled_window);
 
-    for (size_t j = i; j < cpuFreq->cpus.size() && j < i + step; j++) {
-      Ptr<const CpuInfo> cpu = cpuFreq->cpus[j];
-      cpufreq_overview_add (cpu, j, dialog_hbox);
+  xfce4::connect_response (GTK_DIALOG (dialog), cpufreq_overview_response);
 
-      if (j + 1 < cpuFreq->cpus.size() && j + 1 == i + step) {
-        GtkWidget *separator = gtk_separator_new (GTK_ORIENTATION_HORIZONTAL);
-        gtk_box_pack_start (GTK_BOX (cpu_info_box), separator, false, false, 0);
-      }
+  gtk_widget_show_all (dialog);
 
-      if (j + 1 < cpuFreq->cpus.size() && j + 1 < i + step) {
-        GtkWidget *separator = gtk_separator_new (GTK_ORIENTATION_VERTICAL);
-        gtk_box_pack_start (GTK_BOX (dialog_hbox), separator, false, false, 0);
-      }
-    }
-  }
+#ifdef __linux__
+  /* Start the sweep that reads all CPUs now, unless one is still running */
+  cpufreq_update_cpus ();
+#endif
 
-  gtk_container_add (GTK_CONTAINER (scrolled_window), cpu_info_box);
-  gtk_box_pack_start (GTK_BOX (dialog_vbox), scrolled_window, true, true, 0);
+  return true;
+}
 
-  xfce4::connect_response (GTK_DIALOG (dialog), cpufreq_overview_response);
 
-  gtk_widget_show_all (dialog);
 
-  return true;
+void
+cpufreq_overview_refresh ()
+{
+  auto window = (GtkWidget*) g_object_get_data (G_OBJECT (cpuFreq->plugin), "overview");
+  if (!window)
+    return;
+
+  auto scrolled_window = (GtkWidget*) g_object_get_data (G_OBJECT (window), "stale");
+  if (!scrolled_window)
+    return;
+
+  g_object_set_data (G_OBJECT (window), "stale", NULL);
+  cpufreq_overview_fill (scrolled_window);
+  gtk_widget_show_all (scrolled_window);
 }
@@ -26,4 +26,12 @@
 bool
 cpufreq_overview (GdkEventButton *ev);
 
+/*
+ * Rebuilds the overview once a sweep has read all CPUs for it.
+ * The overview is opened with the data that was known at the time,
+ * which can lack the CPUs and governors that weren't displayed before.
+ */
+void
+cpufreq_overview_refresh ();
+
 #endif /* XFCE4_CPUFREQ_OVERVIEW_H */
@@ -45,179 +45,349 @@
 #include "xfce4-cpufreq-linux.h"
 #endif /* __linux__ */
 
+/* Adaptive refresh interval */
+#define ADAPTIVE_TOLERANCE 0.05  /* relative frequency change that counts as a change */
+#define ADAPTIVE_GROWTH    1.5   /* factor by which the interval grows while stable */
+
+/* Tiered sampling of min/max */
+#define HOT_TOLERANCE 0.05  /* relative distance from the extreme that counts as near */
+#define HOT_CPUS_MAX  8
+
+/* How often the position of a mapped but hidden plugin is checked (ms) */
+#define HIDDEN_CHECK_INTERVAL 1000
+
 Ptr0<CpuFreqPlugin> cpuFreq;
 
+std::atomic<guint> cpufreq_governor_generation(0);
+
 
 
 /*
- * Returns a single string describing governors of all CPUs, or an empty string.
+ * Returns the comma-separated names of the governors in the set (in alphabetical ASCII order).
  */
 static std::string
-cpufreq_governors ()
+cpufreq_governors_join (const GovernorMask &mask)
 {
-  /* Governors (in alphabetical ASCII order) */
   std::set<std::string> set;
 
+  for (size_t id = 1; id < mask.size(); id++)
+    if (mask.test (id))
+      set.insert (cpufreq_governor_name (GovernorId (id)));
+
+  return xfce4::join (std::vector<std::string>(set.cbegin(), set.cend()), ",");
+}
+
+
+
+/*
+ * Returns a single interned string describing governors of all CPUs, or 0.
+ *
+ * The label is built only the first time a particular set of governors is seen,
+ * so the steady state doesn't allocate.
+ */
+static GovernorId
+cpufreq_governors ()
+{
+  auto &cache = cpuFreq->governors_cache;
+
+  const guint generation = cpufreq_governor_generation.load ();
+  if (cache.valid && cache.generation == generation)
+    return cache.id;
+
+  GovernorMask mask;
+  GovernorId any = 0;
   for (const Ptr<CpuInfo> &cpu : cpuFreq->cpus)
   {
-    std::lock_guard<std::mutex> guard(cpu->mutex);
-    if (cpu->shared.online && !cpu->shared.cur_governor.empty())
-      set.insert(cpu->shared.cur_governor);
+    const CpuInfo::Shared shared = cpu->load_shared();
+    if (shared.online && shared.cur_governor != 0)
+    {
+      mask.set (shared.cur_governor);
+      any = shared.cur_governor;
+    }
   }
 
-  switch (set.size())
+  GovernorId id;
+  switch (mask.count())
   {
   case 0:
-    return std::string();
+    id = 0;
+    break;
   case 1:
-    return *set.begin();
+    id = any;
+    break;
   default:
-    return xfce4::join(std::vector<std::string>(set.cbegin(), set.cend()), ",");
+  {
+    auto it = cache.labels.find (mask);
+    if (it == cache.labels.end())
+      it = cache.labels.emplace (mask, cpufreq_governor_intern (cpufreq_governors_join (mask))).first;
+    id = it->second;
   }
+  }
+
+  cache.valid = true;
+  cache.generation = generation;
+  cache.id = id;
+  return id;
 }
 
 
 
-static Ptr<CpuInfo>
-cpufreq_cpus_calc_min ()
+/*
+ * Returns cpufreq_governors(), or the label 'fallback' if no governor is known.
+ */
+static GovernorId
+cpufreq_governors_or (const gchar *fallback)
 {
-  const std::string governors = cpufreq_governors ();
-  const std::string old_governor = cpuFreq->cpu_min ? cpuFreq->cpu_min->get_cur_governor() : std::string();
-  guint freq = G_MAXUINT, max_freq_measured = G_MAXUINT, max_freq_nominal = G_MAXUINT, min_freq = G_MAXUINT;
-  guint count = 0;
+  const GovernorId id = cpufreq_governors ();
+  return id != 0 ? id : cpufreq_governor_intern (fallback, strlen (fallback));
+}
 
-  for (const Ptr<CpuInfo> &cpu : cpuFreq->cpus)
-  {
-    std::lock_guard<std::mutex> guard(cpu->mutex);
 
-    if (!cpu->shared.online)
-      continue;
 
-    freq = std::min (freq, cpu->shared.cur_freq);
-    max_freq_measured = std::min (max_freq_measured, cpu->max_freq_measured);
-    max_freq_nominal = std::min (max_freq_nominal, cpu->max_freq_nominal);
-    min_freq = std::min (min_freq, cpu->min_freq);
-    count++;
-  }
+void
+cpufreq_gather_samples (const CpuFreqSnapshot *snapshot)
+{
+  CpuFreqSamples &samples = cpuFreq->samples;
+  const size_t n = cpuFreq->cpus.size();
+
+  if (snapshot && snapshot->cur_freq.size() != n)
+    snapshot = nullptr;
+
+  if (cpuFreq->cpu_set_count != n)
+    cpufreq_update_cpu_set ();
+
+  samples.stable = (samples.size() == n);
 
-  if (count == 0)
-    freq = max_freq_measured = max_freq_nominal = min_freq = 0;
+  samples.cur_freq.resize (n);
+  samples.min_freq.resize (n);
+  samples.max_freq_measured.resize (n);
+  samples.max_freq_nominal.resize (n);
+  samples.online.resize (n);
+  samples.age.resize (n);
+  samples.idle.resize (n);
 
-  Ptr<CpuInfo> cpu = xfce4::make<CpuInfo>();
+  for (size_t i = 0; i < n; i++)
   {
-    std::lock_guard<std::mutex> guard(cpu->mutex);
+    CpuInfo *cpu = &*cpuFreq->cpus[i];
+    guint cur_freq;
+    bool online;
+
+    if (snapshot)
+    {
+      cur_freq = snapshot->cur_freq[i];
+      online = snapshot->online[i];
+    }
+    else
+    {
+      const CpuInfo::Shared shared = cpu->load_shared();
+      cur_freq = shared.cur_freq;
+      online = shared.online;
+    }
+
+    /* Isolated CPUs that aren't sampled and CPUs out of scope don't count towards min, avg and max */
+    if (cpu->isolated && !cpuFreq->options->sample_isolated)
+      online = false;
+    if (!cpu->affine && cpuFreq->options->scope_affinity)
+      online = false;
+    if (!cpuFreq->in_cpu_set (i))
+      online = false;
 
-    cpu->shared.cur_freq = freq;
-    cpu->shared.cur_governor = !governors.empty() ? governors : _("current min");
-    cpu->max_freq_measured = max_freq_measured;
-    cpu->max_freq_nominal = max_freq_nominal;
-    cpu->min_freq = min_freq;
+    cpu->max_freq_measured = MAX (cpu->max_freq_measured, cur_freq);
 
-    if (cpuFreq->options->show_label_governor && cpu->shared.cur_governor != old_governor)
+    if (samples.stable)
     {
-      cpuFreq->label.reset_size = true;
-      cpuFreq->layout_changed = true;
+      const guint prev = samples.cur_freq[i];
+      const guint delta = cur_freq > prev ? cur_freq - prev : prev - cur_freq;
+      if (delta > prev * ADAPTIVE_TOLERANCE || samples.online[i] != online)
+        samples.stable = false;
     }
-  }
 
-  cpuFreq->cpu_min = cpu;
-  return cpu;
+    samples.cur_freq[i] = cur_freq;
+    samples.min_freq[i] = cpu->min_freq;
+    samples.max_freq_measured[i] = cpu->max_freq_measured;
+    samples.max_freq_nominal[i] = cpu->max_freq_nominal;
+    samples.online[i] = online;
+    samples.age[i] = snapshot ? snapshot->age[i] : 0;
+    samples.idle[i] = snapshot ? snapshot->idle[i] : 0;
+  }
 }
 
 
 
+/*
+ * Updates the pseudo-CPU in 'slot' in place, allocating it only the first time.
+ */
 static Ptr<CpuInfo>
-cpufreq_cpus_calc_avg ()
+cpufreq_cpus_set_aggregate (Ptr0<CpuInfo> &slot, const gchar *fallback_label,
+                            guint freq, guint max_freq_measured, guint max_freq_nominal, guint min_freq)
 {
-  const std::string governors = cpufreq_governors ();
-  const std::string old_governor = cpuFreq->cpu_avg ? cpuFreq->cpu_avg->get_cur_governor() : std::string();
-  guint freq = 0, max_freq_measured = 0, max_freq_nominal = 0, min_freq = 0;
-  guint count = 0;
-
-  for (const Ptr<CpuInfo> &cpu : cpuFreq->cpus)
-  {
-    std::lock_guard<std::mutex> guard(cpu->mutex);
+  if (!slot)
+    slot = xfce4::make<CpuInfo>();
+  Ptr<CpuInfo> cpu = slot.toPtr();
 
-    if (!cpu->shared.online)
-      continue;
+  const GovernorId old_governor = cpu->load_shared().cur_governor;
 
-    freq += cpu->shared.cur_freq;
-    max_freq_measured += cpu->max_freq_measured;
-    max_freq_nominal += cpu->max_freq_nominal;
-    min_freq += cpu->min_freq;
-    count++;
-  }
+  CpuInfo::Shared shared;
+  shared.cur_freq = freq;
+  shared.cur_governor = cpufreq_governors_or (fallback_label);
+  cpu->store_shared (shared);
+  cpu->max_freq_measured = max_freq_measured;
+  cpu->max_freq_nominal = max_freq_nominal;
+  cpu->min_freq = min_freq;
 
-  if (count != 0)
+  if (cpuFreq->options->show_label_governor && shared.cur_governor != old_governor)
   {
-    freq /= count;
-    max_freq_measured /= count;
-    max_freq_nominal /= count;
-    min_freq /= count;
+    cpuFreq->label.reset_size = true;
+    cpuFreq->layout_changed = true;
   }
 
-  Ptr<CpuInfo> cpu = xfce4::make<CpuInfo>();
-  {
-    std::lock_guard<std::mutex> guard(cpu->mutex);
+  return cpu;
+}
+
 
-    cpu->shared.cur_freq = freq;
-    cpu->shared.cur_governor = !governors.empty() ? governors : _("current avg");
-    cpu->max_freq_measured = max_freq_measured;
-    cpu->max_freq_nominal = max_freq_nominal;
-    cpu->min_freq = min_freq;
 
-    if (cpuFreq->options->show_label_governor && cpu->shared.cur_governor != old_governor)
+/*
+ * Updates CpuFreqPlugin::hot to the CPU that has the frequency 'extreme'
+ * and to other CPUs within HOT_TOLERANCE of it.
+ */
+static void
+cpufreq_update_hot_cpus (bool track, guint extreme)
+{
+  const CpuFreqSamples &samples = cpuFreq->samples;
+  auto &hot = cpuFreq->hot;
+
+  hot.next.clear();
+  if (track)
+  {
+    const guint tolerance = guint (extreme * HOT_TOLERANCE);
+    for (size_t i = 0; i < samples.size(); i++)
     {
-      cpuFreq->label.reset_size = true;
-      cpuFreq->layout_changed = true;
+      if (samples.online[i] && samples.cur_freq[i] == extreme)
+      {
+        hot.next.push_back (i);
+        break;
+      }
+    }
+    for (size_t i = 0; i < samples.size() && hot.next.size() < HOT_CPUS_MAX; i++)
+    {
+      const guint freq = samples.cur_freq[i];
+      const guint delta = freq > extreme ? freq - extreme : extreme - freq;
+      if (samples.online[i] && delta <= tolerance && (hot.next.empty() || hot.next[0] != i))
+        hot.next.push_back (i);
     }
   }
 
-  cpuFreq->cpu_avg = cpu;
-  return cpu;
+  if (hot.next != hot.cpus)
+  {
+    std::swap (hot.cpus, hot.next);
+    hot.generation++;
+  }
 }
 
 
 
-static Ptr<CpuInfo>
-cpufreq_cpus_calc_max ()
+/*
+ * Returns the median of 'values', reordering them.
+ * The median of an even number of values is the mean of the two middle values.
+ */
+static guint
+cpufreq_median (std::vector<guint> &values)
 {
-  const std::string governors = cpufreq_governors ();
-  const std::string old_governor = cpuFreq->cpu_max ? cpuFreq->cpu_max->get_cur_governor() : std::string();
-  guint freq = 0, max_freq_measured = 0, max_freq_nominal = 0, min_freq = 0;
+  const size_t mid = values.size() / 2;
+  std::nth_element (values.begin(), values.begin() + mid, values.end());
+  guint64 median = values[mid];
+  if (values.size() % 2 == 0)
+    median = (median + *std::max_element (values.begin(), values.begin() + mid)) / 2;
+  return guint (median);
+}
 
-  for (const Ptr<CpuInfo> &cpu : cpuFreq->cpus)
-  {
-    std::lock_guard<std::mutex> guard(cpu->mutex);
 
-    if (!cpu->shared.online)
-      continue;
 
-    freq = std::max (freq, cpu->shared.cur_freq);
-    max_freq_measured = std::max (max_freq_measured, cpu->max_freq_measured);
-    max_freq_nominal = std::max (max_freq_nominal, cpu->max_freq_nominal);
-    min_freq = std::max (min_freq, cpu->min_freq);
-  }
+/*
+ * Computes the minimum, average and maximum of all online CPUs in a single pass
+ * and returns the pseudo-CPU selected by 'show_cpu' (CPU_MIN, CPU_AVG, CPU_MAX or CPU_MEDIAN).
+ * The median needs a second pass.
+ */
+static Ptr<CpuInfo>
+cpufreq_cpus_calc (gint show_cpu)
+{
+  const CpuFreqSamples &samples = cpuFreq->samples;
+  if (samples.size() != cpuFreq->cpus.size())
+    cpufreq_gather_samples (nullptr);
+
+  const size_t n = samples.size();
+  const guint *cur_freq = samples.cur_freq.data();
+  const guint *min_freq = samples.min_freq.data();
+  const guint *max_freq_measured = samples.max_freq_measured.data();
+  const guint *max_freq_nominal = samples.max_freq_nominal.data();
+  const guint8 *online = samples.online.data();
+
+  guint min[4] = { G_MAXUINT, G_MAXUINT, G_MAXUINT, G_MAXUINT };
+  guint max[4] = {};
+  guint64 sum[4] = {};
+  guint count = 0;
 
-  Ptr<CpuInfo> cpu = xfce4::make<CpuInfo>();
+  /* Branchless, so that the compiler can vectorize the loop: offline CPUs are masked out */
+  for (size_t i = 0; i < n; i++)
   {
-    std::lock_guard<std::mutex> guard(cpu->mutex);
+    const guint on = 0u - online[i];
+    const guint values[4] = {
+      cur_freq[i] & on,
+      max_freq_measured[i] & on,
+      max_freq_nominal[i] & on,
+      min_freq[i] & on,
+    };
+    for (guint j = 0; j < 4; j++)
+    {
+      min[j] = std::min (min[j], values[j] | ~on);
+      max[j] = std::max (max[j], values[j]);
+      sum[j] += values[j];
+    }
+    count += online[i];
+  }
 
-    cpu->shared.cur_freq = freq;
-    cpu->shared.cur_governor = !governors.empty() ? governors : _("current max");
-    cpu->max_freq_measured = max_freq_measured;
-    cpu->max_freq_nominal = max_freq_nominal;
-    cpu->min_freq = min_freq;
+  cpufreq_update_hot_cpus (count != 0 && (show_cpu == CPU_MIN || show_cpu == CPU_MAX),
+                           show_cpu == CPU_MIN ? min[0] : max[0]);
 
-    if (cpuFreq->options->show_label_governor && cpu->shared.cur_governor != old_governor)
+  guint result[4] = {};
+  if (count != 0 && show_cpu == CPU_MEDIAN)
+  {
+    const guint *columns[4] = { cur_freq, max_freq_measured, max_freq_nominal, min_freq };
+    std::vector<guint> &values = cpuFreq->median_values;
+    values.reserve (n);
+    for (guint j = 0; j < 4; j++)
     {
-      cpuFreq->label.reset_size = true;
-      cpuFreq->layout_changed = true;
+      values.clear();
+      for (size_t i = 0; i < n; i++)
+        if (online[i])
+          values.push_back (columns[j][i]);
+      result[j] = cpufreq_median (values);
+    }
+  }
+  else if (count != 0)
+  {
+    for (guint j = 0; j < 4; j++)
+    {
+      switch (show_cpu)
+      {
+      case CPU_MIN: result[j] = min[j]; break;
+      case CPU_AVG: result[j] = guint (sum[j] / count); break;
+      default:      result[j] = max[j]; break;
+      }
     }
   }
 
-  cpuFreq->cpu_max = cpu;
-  return cpu;
+  switch (show_cpu)
+  {
+  case CPU_MIN:
+    return cpufreq_cpus_set_aggregate (cpuFreq->cpu_min, _("current min"), result[0], result[1], result[2], result[3]);
+  case CPU_AVG:
+    return cpufreq_cpus_set_aggregate (cpuFreq->cpu_avg, _("current avg"), result[0], result[1], result[2], result[3]);
+  case CPU_MEDIAN:
+    return cpufreq_cpus_set_aggregate (cpuFreq->cpu_median, _("current median"), result[0], result[1], result[2], result[3]);
+  default:
+    return cpufreq_cpus_set_aggregate (cpuFreq->cpu_max, _("current max"), result[0], result[1], result[2], result[3]);
+  }
 }
 
 
@@ -240,18 +410,18 @@ cpufreq_update_label (const Ptr<CpuInfo> &cpu)
 
   std::string label;
   {
-    std::lock_guard<std::mutex> guard(cpu->mutex);
+    const CpuInfo::Shared shared = cpu->load_shared();
 
     if (options->show_label_freq)
     {
-      std::string freq = cpufreq_get_human_readable_freq (cpu->shared.cur_freq, options->unit);
+      std::string freq = cpufreq_get_human_readable_freq (shared.cur_freq, options->unit);
       label += freq;
     }
-    if (options->show_label_governor && !cpu->shared.cur_governor.empty())
+    if (options->show_label_governor && shared.cur_governor != 0)
     {
       if (!label.empty())
         label += options->one_line ? " " : "\n";
-      label += cpu->shared.cur_governor;
+      label += cpufreq_governor_name (shared.cur_governor);
     }
   }
 
@@ -408,15 +578,13 @@ cpufreq_current_cpu ()
   switch (cpuFreq->options->show_cpu)
   {
   case CPU_MIN:
-    cpu = cpufreq_cpus_calc_min ();
-    break;
   case CPU_AVG:
-    cpu = cpufreq_cpus_calc_avg ();
-    break;
   case CPU_MAX:
-    cpu = cpufreq_cpus_calc_max ();
+  case CPU_MEDIAN:
+    cpu = cpufreq_cpus_calc (cpuFreq->options->show_cpu);
     break;
   default:
+    cpufreq_update_hot_cpus (false, 0);
     if (cpuFreq->options->show_cpu >= 0 && guint(cpuFreq->options->show_cpu) < cpuFreq->cpus.size())
       cpu = cpuFreq->cpus[cpuFreq->options->show_cpu];
   }
@@ -480,9 +648,9 @@ cpufreq_update_pixmap (const Ptr<CpuInfo> &cpu)
   const gdouble range = freq_99 - cpu->min_freq;
   gdouble normalized_freq;
   {
-    std::lock_guard<std::mutex> guard(cpu->mutex);
-    if (cpu->shared.cur_freq > cpu->min_freq && range >= min_range)
-      normalized_freq = (cpu->shared.cur_freq - cpu->min_freq) / range;
+    const guint cur_freq = cpu->load_shared().cur_freq;
+    if (cur_freq > cpu->min_freq && range >= min_range)
+      normalized_freq = (cur_freq - cpu->min_freq) / range;
     else
       normalized_freq = 0;
   }
@@ -581,21 +749,55 @@ cpufreq_update_tooltip (GtkTooltip *tooltip)
     }
     else
     {
-      std::lock_guard<std::mutex> guard(cpu->mutex);
+      const CpuInfo::Shared shared = cpu->load_shared();
 
       if(!options->show_label_freq)
       {
         tooltip_msg += _("Frequency: ");
-        tooltip_msg += cpufreq_get_human_readable_freq (cpu->shared.cur_freq, options->unit);
+        tooltip_msg += cpufreq_get_human_readable_freq (shared.cur_freq, options->unit);
       }
-      if(!options->show_label_governor && !cpu->shared.cur_governor.empty())
+      if(!options->show_label_governor && shared.cur_governor != 0)
       {
         if(!tooltip_msg.empty())
           tooltip_msg += "\n";
         tooltip_msg += _("Governor: ");
-        tooltip_msg += cpu->shared.cur_governor;
+        tooltip_msg += cpufreq_governor_name (shared.cur_governor);
+      }
+    }
+  }
+
+  if (cpuFreq->options->show_cpu < 0)
+  {
+    /* Staleness of the samples the aggregate is based on */
+    const CpuFreqSamples &samples = cpuFreq->samples;
+    guint age = 0, idle = 0;
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+      if (samples.online[i])
+      {
+        age = MAX (age, samples.age[i]);
+        idle += samples.idle[i];
       }
     }
+    if (age != 0)
+    {
+      if (!tooltip_msg.empty())
+        tooltip_msg += "\n";
+      tooltip_msg += xfce4::sprintf (_("Oldest sample: %u updates ago"), age);
+    }
+    if (idle != 0)
+    {
+      if (!tooltip_msg.empty())
+        tooltip_msg += "\n";
+      tooltip_msg += xfce4::sprintf (_("Idle CPUs: %u"), idle);
+    }
+  }
+
+  if (cpuFreq->options->timeout_adaptive && cpuFreq->timeout_ms != 0)
+  {
+    if (!tooltip_msg.empty())
+      tooltip_msg += "\n";
+    tooltip_msg += xfce4::sprintf (_("Update interval: %.2f s"), cpuFreq->timeout_ms / 1000.0);
   }
 
   gtk_tooltip_set_text (tooltip, tooltip_msg.c_str());
@@ -604,6 +806,32 @@ cpufreq_update_tooltip (GtkTooltip *tooltip)
 
 
 
+#ifdef __linux__
+static void
+cpufreq_start_timeout (gint timeout_ms)
+{
+  cpuFreq->timeout_ms = timeout_ms;
+  cpuFreq->timeout_next_ms = timeout_ms;
+  cpuFreq->timeoutHandle = xfce4::timeout_add (timeout_ms, []() {
+      const gint handle = cpuFreq->timeoutHandle;
+      cpufreq_update_cpus ();
+
+      /* The samples were published synchronously and shortened the interval */
+      if (G_UNLIKELY (cpuFreq->timeoutHandle != handle))
+        return xfce4::TIMEOUT_REMOVE;
+
+      if (G_LIKELY (cpuFreq->timeout_next_ms == cpuFreq->timeout_ms))
+        return xfce4::TIMEOUT_AGAIN;
+
+      /* The adaptive interval grew */
+      cpufreq_start_timeout (cpuFreq->timeout_next_ms);
+      return xfce4::TIMEOUT_REMOVE;
+  });
+}
+#endif
+
+
+
 void
 cpufreq_restart_timeout ()
 {
@@ -614,16 +842,197 @@ cpufreq_restart_timeout ()
     cpuFreq->timeoutHandle = 0;
   }
 
+  if (cpuFreq->is_paused ())
+    return;
+
   int timeout_ms = int(1000 * cpuFreq->options->timeout);
   if (G_LIKELY (timeout_ms >= 10))
   {
     xfce4::invoke_later (cpufreq_update_cpus);
+    cpufreq_start_timeout (timeout_ms);
+  }
+#endif
+}
 
-    cpuFreq->timeoutHandle = xfce4::timeout_add (timeout_ms, []() {
-        cpufreq_update_cpus ();
-        return xfce4::TIMEOUT_AGAIN;
+
+
+/*
+ * Stops or restarts the sampling after the paused state changed.
+ * Restarting takes a sample immediately.
+ */
+static void
+cpufreq_set_paused (bool *flag, bool value)
+{
+  const bool was_paused = cpuFreq->is_paused ();
+  *flag = value;
+  if (cpuFreq->is_paused () != was_paused)
+    cpufreq_restart_timeout ();
+}
+
+
+
+static void
+cpufreq_screensaver_changed (GDBusConnection *connection, const gchar *sender_name, const gchar *object_path,
+                             const gchar *interface_name, const gchar *signal_name, GVariant *parameters,
+                             gpointer user_data)
+{
+  if (G_UNLIKELY (cpuFreq == nullptr) || !g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(b)")))
+    return;
+
+  gboolean active = false;
+  g_variant_get (parameters, "(b)", &active);
+  cpufreq_set_paused (&cpuFreq->paused.screensaver, active);
+}
+
+
+
+/*
+ * Whether at least half of the plugin is on its monitor and inside its window.
+ * An autohidden panel stays mapped, but moves or shrinks to a thin strip at the edge.
+ */
+static bool
+cpufreq_on_screen ()
+{
+  GtkWidget *widget = GTK_WIDGET (cpuFreq->plugin);
+  GtkWidget *toplevel = gtk_widget_get_toplevel (widget);
+  GdkWindow *window = gtk_widget_get_window (toplevel);
+  if (!gtk_widget_get_mapped (widget) || !gtk_widget_is_toplevel (toplevel) || window == NULL)
+    return false;
+
+  gint x, y, wx, wy;
+  if (!gtk_widget_translate_coordinates (widget, toplevel, 0, 0, &x, &y))
+    return false;
+  gdk_window_get_origin (window, &wx, &wy);
+
+  GdkRectangle rect, frame, monitor;
+  rect.x = wx + x;
+  rect.y = wy + y;
+  rect.width = gtk_widget_get_allocated_width (widget);
+  rect.height = gtk_widget_get_allocated_height (widget);
+  const gint64 area = gint64 (rect.width) * rect.height;
+
+  gdk_window_get_frame_extents (window, &frame);
+  GdkMonitor *mon = gdk_display_get_monitor_at_window (gdk_window_get_display (window), window);
+  if (mon != NULL)
+    gdk_monitor_get_geometry (mon, &monitor);
+  else
+    monitor = frame;
+
+  if (!gdk_rectangle_intersect (&rect, &frame, &rect) || !gdk_rectangle_intersect (&rect, &monitor, &rect))
+    return false;
+  return 2 * gint64 (rect.width) * rect.height >= area;
+}
+
+
+
+/*
+ * Updates paused.hidden. While the plugin is mapped but off the screen,
+ * its position is polled because a moving panel does not always resize it.
+ */
+static void
+cpufreq_check_hidden ()
+{
+  if (G_UNLIKELY (cpuFreq == nullptr))
+    return;
+
+  const bool hidden = !cpufreq_on_screen ();
+  const bool poll = hidden && gtk_widget_get_mapped (GTK_WIDGET (cpuFreq->plugin));
+
+  if (poll && cpuFreq->hidden_check == 0)
+  {
+    cpuFreq->hidden_check = xfce4::timeout_add (HIDDEN_CHECK_INTERVAL, []() {
+      if (G_UNLIKELY (cpuFreq == nullptr))
+        return xfce4::TIMEOUT_REMOVE;
+      cpufreq_check_hidden ();
+      return cpuFreq->hidden_check != 0 ? xfce4::TIMEOUT_AGAIN : xfce4::TIMEOUT_REMOVE;
     });
   }
+  else if (!poll && cpuFreq->hidden_check != 0)
+  {
+    g_source_remove (cpuFreq->hidden_check);
+    cpuFreq->hidden_check = 0;
+  }
+
+  cpufreq_set_paused (&cpuFreq->paused.hidden, hidden);
+}
+
+
+
+/*
+ * Pauses the sampling while the plugin is unmapped or off the screen
+ * (e.g. an autohidden panel), and while the screensaver is active
+ * (the session is idle or locked).
+ */
+static void
+cpufreq_watch_visibility ()
+{
+  xfce4::connect_map (GTK_WIDGET (cpuFreq->plugin), [](GtkWidget *widget) {
+      if (G_UNLIKELY (cpuFreq == nullptr))
+        return;
+
+      /* The panel window moves and resizes when it is autohidden */
+      GtkWidget *toplevel = gtk_widget_get_toplevel (widget);
+      if (gtk_widget_is_toplevel (toplevel) && toplevel != cpuFreq->toplevel)
+      {
+        cpuFreq->toplevel = toplevel;
+        xfce4::connect_configure (toplevel, [](GtkWidget *window, GdkEventConfigure*) {
+            /* Handlers of a previous toplevel or plugin instance stay connected, but do nothing */
+            if (G_LIKELY (cpuFreq != nullptr) && window == cpuFreq->toplevel)
+              cpufreq_check_hidden ();
+            return xfce4::PROPAGATE;
+        });
+      }
+
+      cpufreq_check_hidden ();
+  });
+  xfce4::connect_unmap (GTK_WIDGET (cpuFreq->plugin), [](GtkWidget*) {
+      cpufreq_check_hidden ();
+  });
+
+  cpuFreq->session_bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, NULL);
+  if (cpuFreq->session_bus)
+  {
+    static const gchar *const interfaces[] = { "org.freedesktop.ScreenSaver", "org.xfce.ScreenSaver" };
+    static_assert (G_N_ELEMENTS (interfaces) == G_N_ELEMENTS (cpuFreq->screensaver_subscriptions), "");
+
+    for (gsize i = 0; i < G_N_ELEMENTS (interfaces); i++)
+    {
+      cpuFreq->screensaver_subscriptions[i] = g_dbus_connection_signal_subscribe (
+        cpuFreq->session_bus, NULL, interfaces[i], "ActiveChanged", NULL, NULL,
+        G_DBUS_SIGNAL_FLAGS_NONE, cpufreq_screensaver_changed, NULL, NULL);
+    }
+  }
+}
+
+
+
+void
+cpufreq_adapt_timeout ()
+{
+  auto options = cpuFreq->options;
+
+  if (cpuFreq->timeoutHandle == 0)
+    return;
+
+  const gint min_ms = gint (1000 * options->timeout);
+  const gint max_ms = gint (1000 * MAX (options->timeout, options->timeout_max));
+
+  /*
+   * Lengthen the interval gradually while the frequencies are flat,
+   * and return to the configured interval as soon as they change.
+   * A longer interval takes effect at the next tick, a shorter one right away.
+   */
+  if (options->timeout_adaptive && cpuFreq->samples.stable)
+    cpuFreq->timeout_next_ms = MIN (gint (cpuFreq->timeout_ms * ADAPTIVE_GROWTH), max_ms);
+  else
+    cpuFreq->timeout_next_ms = min_ms;
+
+#ifdef __linux__
+  if (cpuFreq->timeout_next_ms < cpuFreq->timeout_ms)
+  {
+    g_source_remove (cpuFreq->timeoutHandle);
+    cpufreq_start_timeout (cpuFreq->timeout_next_ms);
+  }
 #endif
 }
 
@@ -900,7 +1309,13 @@ cpufreq_read_config ()
     const CpuFreqPluginOptions defaults;
 
     options->timeout             = rc->read_float_entry("timeout", defaults.timeout);
+    options->timeout_max         = rc->read_float_entry("timeout_max", defaults.timeout_max);
+    options->timeout_adaptive    = rc->read_bool_entry ("timeout_adaptive", defaults.timeout_adaptive);
+    options->sample_slices       = rc->read_int_entry  ("sample_slices", defaults.sample_slices);
+    options->sample_isolated     = rc->read_bool_entry ("sample_isolated", defaults.sample_isolated);
+    options->scope_affinity      = rc->read_bool_entry ("scope_affinity", defaults.scope_affinity);
     options->show_cpu            = rc->read_int_entry  ("show_cpu", defaults.show_cpu);
+    options->show_cpu_set        = rc->read_entry      ("show_cpu_set", defaults.show_cpu_set);
     options->show_icon           = rc->read_bool_entry ("show_icon", defaults.show_icon);
     options->show_label_freq     = rc->read_bool_entry ("show_label_freq", defaults.show_label_freq);
     options->show_label_governor = rc->read_bool_entry ("show_label_governor", defaults.show_label_governor);
@@ -918,6 +1333,25 @@ cpufreq_read_config ()
   }
 
   options->validate();
+  cpufreq_update_cpu_set ();
+}
+
+
+
+void
+cpufreq_update_cpu_set ()
+{
+  std::vector<bool> &cpu_set = cpuFreq->cpu_set;
+  cpuFreq->cpu_set_count = cpuFreq->cpus.size();
+
+#ifdef __linux__
+  cpufreq_linux_read_affinity ();
+#endif
+
+  /* An invalid list, or one without any existing CPU, aggregates all CPUs */
+  if (!cpufreq_parse_cpu_list (cpuFreq->options->show_cpu_set.c_str(), cpuFreq->cpu_set_count, cpu_set) ||
+      std::find (cpu_set.begin(), cpu_set.end(), true) == cpu_set.end())
+    cpu_set.clear();
 }
 
 
@@ -939,7 +1373,13 @@ cpufreq_write_config (XfcePanelPlugin *plugin)
     const CpuFreqPluginOptions defaults;
 
     rc->write_default_float_entry("timeout",             options->timeout, defaults.timeout, 0.001);
+    rc->write_default_float_entry("timeout_max",         options->timeout_max, defaults.timeout_max, 0.001);
+    rc->write_default_bool_entry ("timeout_adaptive",    options->timeout_adaptive, defaults.timeout_adaptive);
+    rc->write_default_int_entry  ("sample_slices",       options->sample_slices, defaults.sample_slices);
+    rc->write_default_bool_entry ("sample_isolated",     options->sample_isolated, defaults.sample_isolated);
+    rc->write_default_bool_entry ("scope_affinity",      options->scope_affinity, defaults.scope_affinity);
     rc->write_default_int_entry  ("show_cpu",            options->show_cpu, defaults.show_cpu);
+    rc->write_default_entry      ("show_cpu_set",        options->show_cpu_set, defaults.show_cpu_set);
     rc->write_default_bool_entry ("show_icon",           options->show_icon, defaults.show_icon);
     rc->write_default_bool_entry ("show_label_freq",     options->show_label_freq, defaults.show_label_freq);
     rc->write_default_bool_entry ("show_label_governor", options->show_label_governor, defaults.show_label_governor);
@@ -966,6 +1406,12 @@ cpufreq_free (XfcePanelPlugin*)
     cpuFreq->timeoutHandle = 0;
   }
 
+  if (cpuFreq->hidden_check)
+  {
+    g_source_remove (cpuFreq->hidden_check);
+    cpuFreq->hidden_check = 0;
+  }
+
   cpuFreq = nullptr;
 }
 
@@ -1036,6 +1482,7 @@ cpufreq_plugin_construct (XfcePanelPlugin *plugin)
   xfce_dialog_show_error (NULL, NULL, _("Your system is not supported yet!"));
 #endif /* __linux__ */
 
+  cpufreq_watch_visibility ();
   cpufreq_restart_timeout ();
 
   xfce4::connect_free_data (plugin, cpufreq_free);
@@ -1052,10 +1499,9 @@ cpufreq_plugin_construct (XfcePanelPlugin *plugin)
 
 
 
-std::string CpuInfo::get_cur_governor() const
+const std::string& CpuInfo::get_cur_governor() const
 {
-    std::lock_guard<std::mutex> guard(mutex);
-    return shared.cur_governor;
+    return cpufreq_governor_name (load_shared().cur_governor);
 }
 
 
@@ -1074,6 +1520,14 @@ CpuFreqPlugin::~CpuFreqPlugin()
   if (G_UNLIKELY (timeoutHandle))
     g_source_remove (timeoutHandle);
 
+  if (session_bus)
+  {
+    for (guint id : screensaver_subscriptions)
+      if (id != 0)
+        g_dbus_connection_signal_unsubscribe (session_bus, id);
+    g_object_unref (session_bus);
+  }
+
   if (label.font_desc)
     pango_font_description_free (label.font_desc);
 
@@ -1132,6 +1586,16 @@ void CpuFreqPluginOptions::validate()
   else if (timeout > TIMEOUT_MAX)
     timeout = TIMEOUT_MAX;
 
+  if (sample_slices < 1)
+    sample_slices = 1;
+  else if (sample_slices > SAMPLE_SLICES_MAX)
+    sample_slices = SAMPLE_SLICES_MAX;
+
+  if (timeout_max < TIMEOUT_MIN)
+    timeout_max = TIMEOUT_MIN;
+  else if (timeout_max > TIMEOUT_MAX)
+    timeout_max = TIMEOUT_MAX;
+
   if (!show_label_freq && !show_label_governor)
     show_icon = true;
 
@@ -22,10 +22,12 @@
 #ifndef XFCE4_CPUFREQ_H
 #define XFCE4_CPUFREQ_H
 
+#include <atomic>
+#include <bitset>
 #include <gtk/gtk.h>
 #include <libxfce4panel/libxfce4panel.h>
-#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "xfce4++/util.h"
 
@@ -37,6 +39,7 @@ using xfce4::Ptr0;
 #define CPU_MIN (-1)
 #define CPU_AVG (-2)
 #define CPU_MAX (-3)
+#define CPU_MEDIAN (-4)
 #define CPU_DEFAULT CPU_MAX
 
 #define FREQ_HIST_BINS 128           /* number of bins */
@@ -52,30 +55,105 @@ enum CpuFreqUnit
 
 #define UNIT_DEFAULT UNIT_GHZ
 
+#define GOVERNOR_IDS_MAX 1024
+
+/* A governor name interned by cpufreq_governor_intern(), 0 is the empty name */
+typedef guint16 GovernorId;
+
+/* A set of governors, bit N is set if GovernorId N is in the set */
+typedef std::bitset<GOVERNOR_IDS_MAX> GovernorMask;
+
 struct CpuInfo
 {
-  mutable std::mutex mutex;
-
   /*
    * These fields are shared among multiple OS threads.
-   * Use the mutex when accessing these fields.
+   *
+   * They are published as a single atomic 64-bit snapshot:
+   * writers never block readers, and readers never see a torn snapshot.
    */
   struct Shared {
-    guint cur_freq = 0;  /* frequency in kHz */
-    std::string cur_governor;
-    bool online = false;
-  } shared;
+    guint      cur_freq = 0;      /* frequency in kHz */
+    GovernorId cur_governor = 0;
+    bool       online = false;
+  };
 
   guint  min_freq = 0;
   guint  max_freq_measured = 0;
   guint  max_freq_nominal = 0;
 
+  /* Whether the CPU is excluded from the scheduler's housekeeping by isolcpus= or nohz_full= */
+  bool   isolated = false;
+
+  /* Whether the affinity mask of the plugin's process contains the CPU */
+  bool   affine = true;
+
   std::string scaling_driver;
 
   std::vector<guint> available_freqs;
   std::vector<std::string> available_governors;
 
-  std::string get_cur_governor() const;
+  Shared load_shared() const { return unpack(shared.load(std::memory_order_acquire)); }
+  void store_shared(const Shared &s) { shared.store(pack(s), std::memory_order_release); }
+
+  /* Modifies the snapshot atomically. The function 'update' can be called multiple times. */
+  template<typename F>
+  void update_shared(F update) {
+    guint64 old_word = shared.load(std::memory_order_relaxed);
+    Shared s;
+    do {
+      s = unpack(old_word);
+      update(s);
+    } while (!shared.compare_exchange_weak(old_word, pack(s), std::memory_order_acq_rel, std::memory_order_relaxed));
+  }
+
+  const std::string& get_cur_governor() const;
+
+private:
+  std::atomic<guint64> shared{0};
+
+  static guint64 pack(const Shared &s) {
+    return guint64(s.cur_freq) | (guint64(s.cur_governor) << 32) | (guint64(s.online) << 48);
+  }
+  static Shared unpack(guint64 word) {
+    Shared s;
+    s.cur_freq = guint(word);
+    s.cur_governor = GovernorId(word >> 32);
+    s.online = ((word >> 48) & 1) != 0;
+    return s;
+  }
+};
+
+/*
+ * The latest samples of all CPUs in CpuFreqPlugin::cpus, as a structure of arrays.
+ * Filled by cpufreq_gather_samples() in the main thread.
+ */
+struct CpuFreqSamples
+{
+  std::vector<guint>  cur_freq;
+  std::vector<guint>  min_freq;
+  std::vector<guint>  max_freq_measured;
+  std::vector<guint>  max_freq_nominal;
+  std::vector<guint8> online;            /* 0 or 1 */
+  std::vector<guint>  age;               /* number of refreshes since the CPU was sampled */
+  std::vector<guint8> idle;              /* 1 if cur_freq is the last value of an idle CPU */
+
+  /* Whether no frequency or online state changed notably since the previous samples */
+  bool stable = false;
+
+  size_t size() const { return cur_freq.size(); }
+};
+
+/*
+ * The result of one complete sampling sweep, built by a sampler thread.
+ * The snapshot is immutable once it has been published.
+ */
+struct CpuFreqSnapshot
+{
+  std::vector<guint>  cur_freq;
+  std::vector<guint8> online;            /* 0 or 1 */
+  std::vector<guint>  age;               /* number of sweeps since the CPU was sampled */
+  std::vector<guint8> idle;              /* 1 if the frequency wasn't read because the CPU was idle */
+  bool overview = false;                 /* whether the sweep read all CPUs for the overview */
 };
 
 struct IntelPState
@@ -88,7 +166,13 @@ struct IntelPState
 struct CpuFreqPluginOptions
 {
   float       timeout = 1.0;           /* refresh interval, in seconds */
-  gint        show_cpu = CPU_DEFAULT;  /* cpu number in panel, or CPU_MIN/AVG/MAX */
+  float       timeout_max = 5.0;       /* longest adaptive refresh interval, in seconds */
+  bool        timeout_adaptive = false;
+  guint       sample_slices = 1;       /* sample 1/N of the CPUs per refresh in aggregate views */
+  bool        sample_isolated = false; /* sample isolated CPUs, without interrupting them */
+  bool        scope_affinity = false;  /* sample and aggregate only the CPUs the process may run on */
+  gint        show_cpu = CPU_DEFAULT;  /* cpu number in panel, or CPU_MIN/AVG/MAX/MEDIAN */
+  std::string show_cpu_set;            /* CPUs that CPU_MIN/AVG/MAX/MEDIAN aggregate, for example "0-7,16-23", or empty for all CPUs */
   bool        show_icon = true;
   bool        show_label_freq = true;
   bool        show_label_governor = true;
@@ -113,10 +197,29 @@ struct CpuFreqPlugin
   /* Array with all CPUs */
   std::vector<Ptr<CpuInfo>> cpus;
 
+  /* Samples of 'cpus' used to calculate the values below */
+  CpuFreqSamples samples;
+
+  /*
+   * The CPUs that set or are near the displayed minimum or maximum.
+   * Samplers may read the other CPUs less often.
+   */
+  struct {
+    std::vector<guint> cpus;
+    std::vector<guint> next;
+    guint              generation = 0;  /* incremented when 'cpus' changes */
+  } hot;
+
+  /* Parsed options->show_cpu_set, empty if all CPUs are aggregated */
+  std::vector<bool> cpu_set;
+  size_t cpu_set_count = 0;  /* cpus.size() when cpu_set was parsed */
+
   /* Calculated values */
   Ptr0<CpuInfo> cpu_min;
   Ptr0<CpuInfo> cpu_avg;
   Ptr0<CpuInfo> cpu_max;
+  Ptr0<CpuInfo> cpu_median;
+  std::vector<guint> median_values;  /* scratch buffer of the median, reused at every update */
 
   /* Intel P-State parameters */
   Ptr0<IntelPState> intel_pstate;
@@ -144,26 +247,75 @@ struct CpuFreqPlugin
    *  resolution: range / FREQ_HIST_BINS = 62.5 MHz */
   guint16 freq_hist[FREQ_HIST_BINS] = {};
 
+  /* Cached result of cpufreq_governors(), valid while cpufreq_governor_generation doesn't change */
+  struct {
+    bool       valid = false;
+    guint      generation = 0;
+    GovernorId id = 0;
+
+    /* The interned comma-separated label of each set of governors seen so far */
+    std::unordered_map<GovernorMask, GovernorId> labels;
+  } governors_cache;
+
   GtkWidget *settings_dialog = nullptr;
   const Ptr<CpuFreqPluginOptions> options = xfce4::make<CpuFreqPluginOptions>();
 
   gint timeoutHandle = 0;
+  gint timeout_ms = 0;                 /* the refresh interval of the armed timer */
+  gint timeout_next_ms = 0;            /* the refresh interval from the next tick on */
+
+  /* Sampling is paused while nobody can see the plugin */
+  struct {
+    bool hidden = false;       /* unmapped, or off the screen (e.g. an autohidden panel) */
+    bool screensaver = false;
+  } paused;
+  GtkWidget *toplevel = nullptr;  /* the window whose configure events are watched */
+  guint hidden_check = 0;         /* re-checks the position while hidden but still mapped */
+  GDBusConnection *session_bus = nullptr;
+  guint screensaver_subscriptions[2] = {};
 
   CpuFreqPlugin(XfcePanelPlugin *plugin);
   ~CpuFreqPlugin();
 
+  bool is_paused() const { return paused.hidden || paused.screensaver; }
+  bool in_cpu_set(size_t cpu) const { return cpu_set.empty() || (cpu < cpu_set.size() && cpu_set[cpu]); }
   void destroy_icons();
   void set_font(const std::string &fontname_orEmpty);
 };
 
 extern Ptr0<CpuFreqPlugin> cpuFreq;
 
+/*
+ * Incremented whenever the governor or the online state of a CPU
+ * in CpuFreqPlugin::cpus changes, or when the set of CPUs changes.
+ */
+extern std::atomic<guint> cpufreq_governor_generation;
+
+/*
+ * Copies the current samples of all CPUs to CpuFreqPlugin::samples.
+ * The frequencies and online states are taken from 'snapshot' if it is not null.
+ */
+void
+cpufreq_gather_samples (const CpuFreqSnapshot *snapshot);
+
 void
 cpufreq_prepare_label ();
 
+/*
+ * Parses options->show_cpu_set into CpuFreqPlugin::cpu_set and, on Linux,
+ * reads which CPUs are in the process's affinity mask.
+ * Called again by the samplers if the number of CPUs has changed since.
+ */
+void
+cpufreq_update_cpu_set ();
+
 void
 cpufreq_restart_timeout ();
 
+/* Adjusts the adaptive refresh interval after new samples have been gathered */
+void
+cpufreq_adapt_timeout ();
+
 void
 cpufreq_update_icon ();
 
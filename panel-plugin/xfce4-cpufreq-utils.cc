@@ -20,10 +20,25 @@
  */
 
 #include <libxfce4ui/libxfce4ui.h>
+#include <mutex>
 #include <stdlib.h>
+#include <string.h>
 #include "xfce4-cpufreq-plugin.h"
 #include "xfce4-cpufreq-utils.h"
 
+/*
+ * The governor names, indexed by GovernorId. Entries are only appended and never freed,
+ * so readers don't need a lock. The number of names is small: the governors themselves
+ * and the combined labels of the min/avg/max pseudo-CPUs.
+ */
+static std::atomic<const std::string*> governor_names[GOVERNOR_IDS_MAX];
+static std::atomic<guint> governor_count(1);
+static std::mutex governor_mutex;
+
+static GovernorId governor_find (const gchar *name, gsize len, guint begin, guint end);
+
+static const gchar *skip_blanks (const gchar *p);
+
 
 
 std::string
@@ -79,3 +94,126 @@ cpufreq_warn_reset ()
   xfce_dialog_show_warning (NULL, NULL,
     _("The CPU displayed by the XFCE cpufreq plugin has been reset to a default value"));
 }
+
+
+
+static const gchar *
+skip_blanks (const gchar *p)
+{
+  while (*p == ' ' || *p == '\t')
+    p++;
+  return p;
+}
+
+
+
+/*
+ * Parses a list of CPUs in the kernel's format, for example "0-3,8,10-11",
+ * into a mask of 'limit' CPUs. CPUs at or beyond the limit are ignored.
+ * Blanks around the numbers, commas and dashes are allowed, as in "0-7, 16 - 23".
+ */
+bool
+cpufreq_parse_cpu_list (const gchar *str, gsize limit, std::vector<bool> &cpus)
+{
+  cpus.assign (limit, false);
+
+  const gchar *p = str;
+  while (g_ascii_isspace (*p))
+    p++;
+
+  while (*p != '\0' && *p != '\n')
+  {
+    gchar *end;
+    if (!g_ascii_isdigit (*p))
+      return false;
+    guint64 first = g_ascii_strtoull (p, &end, 10);
+    guint64 last = first;
+    p = skip_blanks (end);
+    if (*p == '-')
+    {
+      p = skip_blanks (p + 1);
+      if (!g_ascii_isdigit (*p))
+        return false;
+      last = g_ascii_strtoull (p, &end, 10);
+      p = skip_blanks (end);
+    }
+    if (first > last)
+      return false;
+
+    if (first < limit)
+      std::fill (cpus.begin() + first, cpus.begin() + MIN (last, limit - 1) + 1, true);
+
+    if (*p == ',')
+      p = skip_blanks (p + 1);
+    else if (*p != '\0' && *p != '\n')
+      return false;
+  }
+
+  return true;
+}
+
+
+
+GovernorId
+cpufreq_governor_intern (const gchar *name, gsize len)
+{
+  if (len == 0)
+    return 0;
+
+  guint count = governor_count.load (std::memory_order_acquire);
+  GovernorId id = governor_find (name, len, 1, count);
+  if (id != 0)
+    return id;
+
+  std::lock_guard<std::mutex> guard(governor_mutex);
+
+  /* The name might have been added by another thread */
+  guint count2 = governor_count.load (std::memory_order_relaxed);
+  id = governor_find (name, len, count, count2);
+  if (id != 0)
+    return id;
+
+  if (G_UNLIKELY (count2 == GOVERNOR_IDS_MAX))
+  {
+    g_warning ("Too many governor names");
+    return 0;
+  }
+
+  governor_names[count2].store (new std::string (name, len), std::memory_order_release);
+  governor_count.store (count2 + 1, std::memory_order_release);
+  return GovernorId (count2);
+}
+
+
+
+GovernorId
+cpufreq_governor_intern (const std::string &name)
+{
+  return cpufreq_governor_intern (name.data(), name.size());
+}
+
+
+
+const std::string&
+cpufreq_governor_name (GovernorId id)
+{
+  static const std::string empty;
+
+  if (id == 0 || id >= governor_count.load (std::memory_order_acquire))
+    return empty;
+  return *governor_names[id].load (std::memory_order_acquire);
+}
+
+
+
+static GovernorId
+governor_find (const gchar *name, gsize len, guint begin, guint end)
+{
+  for (guint id = begin; id < end; id++)
+  {
+    const std::string *s = governor_names[id].load (std::memory_order_acquire);
+    if (s->size() == len && memcmp (s->data(), name, len) == 0)
+      return GovernorId (id);
+  }
+  return 0;
+}
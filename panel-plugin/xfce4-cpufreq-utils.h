@@ -28,4 +28,21 @@ cpufreq_get_human_readable_freq (guint freq, CpuFreqUnit unit);
 void
 cpufreq_warn_reset ();
 
+bool
+cpufreq_parse_cpu_list (const gchar *str, gsize limit, std::vector<bool> &cpus);
+
+/*
+ * Returns the ID of the governor name, adding the name to the table if necessary.
+ * Can be called from any thread.
+ */
+GovernorId
+cpufreq_governor_intern (const gchar *name, gsize len);
+
+GovernorId
+cpufreq_governor_intern (const std::string &name);
+
+/* Returns the name of the governor ID, can be called from any thread */
+const std::string&
+cpufreq_governor_name (GovernorId id);
+
 #endif /* XFCE4_CPUFREQ_UTILS_H */
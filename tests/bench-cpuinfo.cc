@@ -0,0 +1,204 @@
+/*  xfce4-cpu-freq-plugin - panel plugin for cpu informations
+ *
+ *  Copyright (c) 2026 The Xfce development team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Compares parsing a /proc/cpuinfo of 256 CPUs line by line with fgets(),
+ * the way the plugin used to do it, against cpufreq_cpuinfo_parse().
+ *
+ * The file is generated from a captured cpuinfo entry of an x86 CPU, including
+ * its long 'flags' line. With --check, only verifies the parsed frequencies and exits.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "xfce4-cpufreq-linux-cpuinfo.h"
+
+#define NUM_CPUS    256
+#define ITERATIONS  200
+
+/* Exit status that makes meson report a skipped test */
+#define EXIT_SKIP 77
+
+/* Arguments: the processor number, the frequency in MHz and its fraction, the APIC ID */
+static const gchar CPUINFO_ENTRY[] =
+  "processor\t: %u\n"
+  "vendor_id\t: GenuineIntel\n"
+  "cpu family\t: 6\n"
+  "model\t\t: 207\n"
+  "model name\t: Intel(R) Xeon(R) Processor\n"
+  "stepping\t: 2\n"
+  "microcode\t: 0x1\n"
+  "cpu MHz\t\t: %u.%03u\n"
+  "cache size\t: 307200 KB\n"
+  "physical id\t: 0\n"
+  "siblings\t: 256\n"
+  "core id\t\t: %u\n"
+  "cpu cores\t: 128\n"
+  "apicid\t\t: %u\n"
+  "initial apicid\t: %u\n"
+  "fpu\t\t: yes\n"
+  "fpu_exception\t: yes\n"
+  "cpuid level\t: 32\n"
+  "wp\t\t: yes\n"
+  "flags\t\t: fpu vme de pse tsc msr pae mce cx8 apic sep mtrr pge mca cmov pat pse36 clflush mmx fxsr "
+  "sse sse2 ss syscall nx pdpe1gb rdtscp lm constant_tsc rep_good nopl xtopology nonstop_tsc cpuid "
+  "tsc_known_freq pni pclmulqdq ssse3 fma cx16 pcid sse4_1 sse4_2 x2apic movbe popcnt tsc_deadline_timer "
+  "aes xsave avx f16c rdrand hypervisor lahf_lm abm 3dnowprefetch cpuid_fault ssbd ibrs ibpb stibp "
+  "ibrs_enhanced fsgsbase tsc_adjust bmi1 avx2 smep bmi2 erms invpcid avx512f avx512dq rdseed adx smap "
+  "avx512ifma clflushopt clwb avx512cd sha_ni avx512bw avx512vl xsaveopt xsavec xgetbv1 xsaves avx_vnni "
+  "avx512_bf16 wbnoinvd arat avx512vbmi umip pku ospke avx512_vbmi2 gfni vaes vpclmulqdq avx512_vnni "
+  "avx512_bitalg avx512_vpopcntdq rdpid bus_lock_detect cldemote movdiri movdir64b fsrm md_clear serialize "
+  "tsxldtrk ibt amx_bf16 avx512_fp16 amx_tile amx_int8 flush_l1d arch_capabilities\n"
+  "bugs\t\t: spectre_v1 spectre_v2 spec_store_bypass swapgs taa eibrs_pbrsb bhi ibpb_no_ret spectre_v2_user\n"
+  "bogomips\t: 4200.00\n"
+  "clflush size\t: 64\n"
+  "cache_alignment\t: 64\n"
+  "address sizes\t: 46 bits physical, 57 bits virtual\n"
+  "power management:\n"
+  "\n";
+
+static guint expected_freq (guint cpu);
+
+static guint parse_fgets (const gchar *path, std::vector<guint> &freqs);
+
+
+
+/* The frequency of the CPU in kHz, with a fractional MHz part */
+static guint
+expected_freq (guint cpu)
+{
+  return 800000 + 12345 * cpu;
+}
+
+
+
+/* The line-by-line parser that the plugin used before */
+static guint
+parse_fgets (const gchar *path, std::vector<guint> &freqs)
+{
+  FILE *file = fopen (path, "r");
+  if (file == NULL)
+    return 0;
+
+  gchar line[256];
+  guint i = 0;
+  while (fgets (line, sizeof (line), file) != NULL)
+  {
+    if (g_ascii_strncasecmp (line, "cpu MHz", 7) == 0)
+    {
+      gchar *freq = g_strrstr (line, ":");
+      if (freq == NULL)
+        break;
+      guint mhz = 0;
+      sscanf (++freq, "%u.", &mhz);
+      if (i < freqs.size())
+        freqs[i] = 1000 * mhz;
+      i++;
+    }
+  }
+  fclose (file);
+  return i;
+}
+
+
+
+int
+main (int argc, char **argv)
+{
+  const bool check = argc > 1 && strcmp (argv[1], "--check") == 0;
+
+  gchar *dir = g_dir_make_tmp ("bench-cpuinfo-XXXXXX", NULL);
+  if (dir == NULL)
+    return EXIT_SKIP;
+  const std::string temp_dir = dir;
+  const std::string path = temp_dir + "/cpuinfo";
+  g_free (dir);
+
+  std::string contents;
+  for (guint cpu = 0; cpu < NUM_CPUS; cpu++)
+  {
+    const guint freq = expected_freq (cpu);
+    gchar *entry = g_strdup_printf (CPUINFO_ENTRY, cpu, freq / 1000, freq % 1000, cpu / 2, cpu, cpu);
+    contents += entry;
+    g_free (entry);
+  }
+  if (!g_file_set_contents (path.c_str(), contents.c_str(), contents.size(), NULL))
+  {
+    g_rmdir (temp_dir.c_str());
+    return EXIT_SKIP;
+  }
+
+  std::vector<guint> freqs (NUM_CPUS, 0);
+  guint count = 0;
+  int status = 0;
+
+  /* Verify the parsed frequencies, including the fractional MHz */
+  if (!cpufreq_cpuinfo_parse (path.c_str(), [&freqs, &count](guint i, guint freq) {
+        if (i < freqs.size())
+          freqs[i] = freq;
+        count++;
+      }))
+  {
+    fprintf (stderr, "cpufreq_cpuinfo_parse() failed\n");
+    status = 1;
+  }
+  if (status == 0 && count != NUM_CPUS)
+  {
+    fprintf (stderr, "parsed %u CPUs instead of %u\n", count, NUM_CPUS);
+    status = 1;
+  }
+  for (guint cpu = 0; cpu < NUM_CPUS && status == 0; cpu++)
+  {
+    if (freqs[cpu] != expected_freq (cpu))
+    {
+      fprintf (stderr, "CPU %u: parsed %u kHz instead of %u kHz\n", cpu, freqs[cpu], expected_freq (cpu));
+      status = 1;
+    }
+  }
+
+  if (!check && status == 0)
+  {
+    gint64 start = g_get_monotonic_time ();
+    for (guint iteration = 0; iteration < ITERATIONS; iteration++)
+      if (parse_fgets (path.c_str(), freqs) != NUM_CPUS)
+        status = 1;
+    const gint64 line_by_line = g_get_monotonic_time () - start;
+
+    start = g_get_monotonic_time ();
+    for (guint iteration = 0; iteration < ITERATIONS; iteration++)
+      cpufreq_cpuinfo_parse (path.c_str(), [&freqs](guint i, guint freq) {
+        if (i < freqs.size())
+          freqs[i] = freq;
+      });
+    const gint64 streaming = g_get_monotonic_time () - start;
+
+    printf ("%u CPUs, %zu bytes, %u parses\n", NUM_CPUS, contents.size(), ITERATIONS);
+    printf ("fgets:     %8.1f us per parse\n", gdouble (line_by_line) / ITERATIONS);
+    printf ("streaming: %8.1f us per parse\n", gdouble (streaming) / ITERATIONS);
+  }
+
+  g_unlink (path.c_str());
+  g_rmdir (temp_dir.c_str());
+  return status;
+}
@@ -0,0 +1,217 @@
+/*  xfce4-cpu-freq-plugin - panel plugin for cpu informations
+ *
+ *  Copyright (c) 2026 The Xfce development team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Measures how fast the main thread can read the samples of 256 synthetic CPUs
+ * while sampler threads keep updating them: the atomic CpuInfo::Shared snapshot
+ * against a mutex-guarded copy with the governor stored as a std::string,
+ * the way the plugin used to store them.
+ *
+ * With --check, only verifies for a short time that no reader sees a torn sample.
+ */
+
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xfce4-cpufreq-plugin.h"
+
+#define NUM_CPUS    256
+#define NUM_WRITERS 4
+#define GOVERNORS   8
+
+/* The old representation of CpuInfo::Shared */
+struct LockedCpu
+{
+  std::mutex mutex;
+  guint cur_freq = 0;
+  std::string cur_governor;
+  bool online = false;
+};
+
+struct Result
+{
+  guint64 sweeps;
+  guint64 torn;
+  guint64 writes;
+  guint64 sum;     /* keeps the reads from being optimized away */
+};
+
+static const gchar *const governor_names[GOVERNORS] = {
+  "", "performance", "powersave", "ondemand", "conservative", "schedutil", "userspace", "custom",
+};
+
+static guint sample_freq (guint64 k);
+
+static Result run_atomic (gint64 duration);
+
+static Result run_locked (gint64 duration);
+
+
+
+/*
+ * The samples satisfy freq % GOVERNORS == governor and online == (governor & 1),
+ * so that a reader can tell a torn sample from a consistent one.
+ */
+static guint
+sample_freq (guint64 k)
+{
+  return 800000 + GOVERNORS * guint (k % 100000) + guint (k % GOVERNORS);
+}
+
+
+
+static Result
+run_atomic (gint64 duration)
+{
+  std::vector<CpuInfo> cpus (NUM_CPUS);
+  std::atomic<bool> stop(false);
+  std::atomic<guint64> writes(0);
+
+  std::vector<std::thread> writers;
+  for (guint w = 0; w < NUM_WRITERS; w++)
+  {
+    writers.emplace_back ([&cpus, &stop, &writes, w]() {
+      guint64 k = w;
+      while (!stop.load (std::memory_order_relaxed))
+      {
+        for (guint i = w; i < NUM_CPUS; i += NUM_WRITERS, k++)
+        {
+          CpuInfo::Shared s;
+          s.cur_freq = sample_freq (k);
+          s.cur_governor = GovernorId (k % GOVERNORS);
+          s.online = (s.cur_governor & 1) != 0;
+          cpus[i].store_shared (s);
+        }
+        writes += NUM_CPUS / NUM_WRITERS;
+      }
+    });
+  }
+
+  Result result = {0, 0, 0, 0};
+  const gint64 end = g_get_monotonic_time () + duration;
+  while (g_get_monotonic_time () < end)
+  {
+    for (const CpuInfo &cpu : cpus)
+    {
+      const CpuInfo::Shared s = cpu.load_shared ();
+      if (s.cur_freq != 0 && (s.cur_freq % GOVERNORS != s.cur_governor || s.online != ((s.cur_governor & 1) != 0)))
+        result.torn++;
+      result.sum += s.cur_freq;
+    }
+    result.sweeps++;
+  }
+
+  stop = true;
+  for (std::thread &writer : writers)
+    writer.join ();
+  result.writes = writes;
+  return result;
+}
+
+
+
+static Result
+run_locked (gint64 duration)
+{
+  std::vector<LockedCpu> cpus (NUM_CPUS);
+  std::atomic<bool> stop(false);
+  std::atomic<guint64> writes(0);
+
+  std::vector<std::thread> writers;
+  for (guint w = 0; w < NUM_WRITERS; w++)
+  {
+    writers.emplace_back ([&cpus, &stop, &writes, w]() {
+      guint64 k = w;
+      while (!stop.load (std::memory_order_relaxed))
+      {
+        for (guint i = w; i < NUM_CPUS; i += NUM_WRITERS, k++)
+        {
+          const guint governor = guint (k % GOVERNORS);
+          std::lock_guard<std::mutex> guard(cpus[i].mutex);
+          cpus[i].cur_freq = sample_freq (k);
+          cpus[i].cur_governor = governor_names[governor];
+          cpus[i].online = (governor & 1) != 0;
+        }
+        writes += NUM_CPUS / NUM_WRITERS;
+      }
+    });
+  }
+
+  Result result = {0, 0, 0, 0};
+  const gint64 end = g_get_monotonic_time () + duration;
+  while (g_get_monotonic_time () < end)
+  {
+    for (LockedCpu &cpu : cpus)
+    {
+      guint cur_freq;
+      std::string cur_governor;
+      bool online;
+      {
+        std::lock_guard<std::mutex> guard(cpu.mutex);
+        cur_freq = cpu.cur_freq;
+        cur_governor = cpu.cur_governor;
+        online = cpu.online;
+      }
+      const guint governor = cur_freq % GOVERNORS;
+      if (cur_freq != 0 && (cur_governor != governor_names[governor] || online != ((governor & 1) != 0)))
+        result.torn++;
+      result.sum += cur_freq;
+    }
+    result.sweeps++;
+  }
+
+  stop = true;
+  for (std::thread &writer : writers)
+    writer.join ();
+  result.writes = writes;
+  return result;
+}
+
+
+
+int
+main (int argc, char **argv)
+{
+  const bool check = argc > 1 && strcmp (argv[1], "--check") == 0;
+  const gint64 duration = (check ? 1 : 10) * G_USEC_PER_SEC / 10;
+
+  const Result atomic = run_atomic (duration);
+  if (atomic.torn != 0)
+  {
+    fprintf (stderr, "%" G_GUINT64_FORMAT " torn samples in %" G_GUINT64_FORMAT " sweeps\n", atomic.torn, atomic.sweeps);
+    return 1;
+  }
+  if (check)
+    return 0;
+
+  const Result locked = run_locked (duration);
+
+  printf ("%u CPUs, %u writer threads, %.1f s per run\n", NUM_CPUS, NUM_WRITERS, gdouble (duration) / G_USEC_PER_SEC);
+  printf ("mutex:  %8.1f ns per CPU read, %6.1f M writes/s\n",
+          1e3 * duration / MAX (locked.sweeps * NUM_CPUS, 1), gdouble (locked.writes) / duration);
+  printf ("atomic: %8.1f ns per CPU read, %6.1f M writes/s\n",
+          1e3 * duration / MAX (atomic.sweeps * NUM_CPUS, 1), gdouble (atomic.writes) / duration);
+  return locked.torn == 0 ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+/*  xfce4-cpu-freq-plugin - panel plugin for cpu informations
+ *
+ *  Copyright (c) 2026 The Xfce development team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Compares the latency of reading a set of sysfs-like files one by one with pread()
+ * against reading them in one cpufreq_uring_read() batch.
+ *
+ * The 'scaling_cur_freq' files of all cpufreq policies are used if there are any,
+ * otherwise files in a temporary directory. With --check, only verifies that the
+ * batch returns the same contents as pread() and exits.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "xfce4-cpufreq-linux-uring.h"
+
+#define BUF_SIZE    32
+#define TEMP_FILES  64
+#define ITERATIONS  200
+
+/* Exit status that makes meson report a skipped test */
+#define EXIT_SKIP 77
+
+static std::vector<std::string> files_find (std::string &temp_dir);
+
+static void files_remove (const std::vector<std::string> &files, const std::string &temp_dir);
+
+
+
+static std::vector<std::string>
+files_find (std::string &temp_dir)
+{
+  std::vector<std::string> files;
+
+  for (guint i = 0; i < 8192; i++)
+  {
+    gchar *file = g_strdup_printf ("/sys/devices/system/cpu/cpufreq/policy%u/scaling_cur_freq", i);
+    if (access (file, R_OK) == 0)
+      files.push_back (file);
+    g_free (file);
+  }
+  if (!files.empty())
+    return files;
+
+  gchar *dir = g_dir_make_tmp ("bench-uring-XXXXXX", NULL);
+  if (dir == NULL)
+    return files;
+  temp_dir = dir;
+  g_free (dir);
+
+  for (guint i = 0; i < TEMP_FILES; i++)
+  {
+    gchar *file = g_strdup_printf ("%s/%u", temp_dir.c_str(), i);
+    gchar *contents = g_strdup_printf ("%u\n", 800000 + 1000 * i);
+    if (g_file_set_contents (file, contents, -1, NULL))
+      files.push_back (file);
+    g_free (contents);
+    g_free (file);
+  }
+  return files;
+}
+
+
+
+static void
+files_remove (const std::vector<std::string> &files, const std::string &temp_dir)
+{
+  if (temp_dir.empty())
+    return;
+  for (const std::string &file : files)
+    g_unlink (file.c_str());
+  g_rmdir (temp_dir.c_str());
+}
+
+
+
+int
+main (int argc, char **argv)
+{
+  const bool check = argc > 1 && strcmp (argv[1], "--check") == 0;
+
+  std::string temp_dir;
+  const std::vector<std::string> files = files_find (temp_dir);
+  const gsize count = files.size();
+  if (count == 0)
+  {
+    fprintf (stderr, "No files to read\n");
+    return EXIT_SKIP;
+  }
+
+  std::vector<int> fds (count);
+  for (gsize i = 0; i < count; i++)
+    fds[i] = open (files[i].c_str(), O_RDONLY | O_CLOEXEC);
+
+  /* Use a ring smaller than the number of files, so that multiple batches are needed */
+  auto uring = cpufreq_uring_new (MAX (count / 2, 1));
+  if (!uring)
+  {
+    fprintf (stderr, "io_uring is not available\n");
+    files_remove (files, temp_dir);
+    return EXIT_SKIP;
+  }
+
+  std::vector<gchar> bufs (count * BUF_SIZE);
+  std::vector<gssize> results (count);
+  gchar buf[BUF_SIZE];
+  int status = 0;
+
+  /* Verify the batch against pread() */
+  if (!cpufreq_uring_read (uring.get(), fds.data(), count, bufs.data(), BUF_SIZE, results.data()))
+  {
+    fprintf (stderr, "cpufreq_uring_read() failed\n");
+    status = 1;
+  }
+  for (gsize i = 0; i < count && status == 0; i++)
+  {
+    /* The frequencies in sysfs change between the reads */
+    ssize_t n = pread (fds[i], buf, BUF_SIZE - 1, 0);
+    if (n < 0 || results[i] < 0 ||
+        (!temp_dir.empty() && (results[i] != n || memcmp (buf, &bufs[i * BUF_SIZE], n) != 0)) ||
+        bufs[i * BUF_SIZE + MAX (results[i], 0)] != '\0')
+    {
+      fprintf (stderr, "%s: the batch read %zd bytes, pread() %zd bytes\n", files[i].c_str(), results[i], n);
+      status = 1;
+    }
+  }
+
+  if (!check && status == 0)
+  {
+    gint64 start = g_get_monotonic_time ();
+    for (guint iteration = 0; iteration < ITERATIONS; iteration++)
+      for (gsize i = 0; i < count; i++)
+        if (pread (fds[i], buf, BUF_SIZE - 1, 0) < 0)
+          status = 1;
+    const gint64 serial = g_get_monotonic_time () - start;
+
+    start = g_get_monotonic_time ();
+    for (guint iteration = 0; iteration < ITERATIONS; iteration++)
+      if (!cpufreq_uring_read (uring.get(), fds.data(), count, bufs.data(), BUF_SIZE, results.data()))
+        status = 1;
+    const gint64 batched = g_get_monotonic_time () - start;
+
+    printf ("%zu files, %u sweeps\n", count, ITERATIONS);
+    printf ("pread:    %8.1f us per sweep\n", gdouble (serial) / ITERATIONS);
+    printf ("io_uring: %8.1f us per sweep\n", gdouble (batched) / ITERATIONS);
+  }
+
+  for (int fd : fds)
+    if (fd >= 0)
+      close (fd);
+  files_remove (files, temp_dir);
+  return status;
+}
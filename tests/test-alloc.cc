@@ -0,0 +1,192 @@
+/*  xfce4-cpu-freq-plugin - panel plugin for cpu informations
+ *
+ *  Copyright (c) 2026 The Xfce development team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Checks that a steady-state sampling tick doesn't allocate memory: the sweep's tasks
+ * are submitted to xfce4::parallelTaskQueue and xfce4::singleThreadQueue, read a set
+ * of sysfs-like files, and wake up the main loop via a persistent xfce4::Wakeup.
+ * The counts come from interposing malloc(), calloc() and realloc().
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+
+#include "xfce4++/util.h"
+
+#define BUF_SIZE    32
+#define TEMP_FILES  64
+#define WARMUP      20
+#define TICKS       200
+
+/* Exit status that makes meson report a skipped test */
+#define EXIT_SKIP 77
+
+#if defined (__SANITIZE_ADDRESS__) || defined (__SANITIZE_THREAD__)
+#define ALLOC_COUNTING 0
+#elif defined (__GLIBC__)
+#define ALLOC_COUNTING 1
+#else
+#define ALLOC_COUNTING 0
+#endif
+
+static std::atomic<bool> counting(false);
+static std::atomic<gsize> allocations(0);
+
+#if ALLOC_COUNTING
+extern "C" void *__libc_malloc (size_t size);
+extern "C" void *__libc_calloc (size_t n, size_t size);
+extern "C" void *__libc_realloc (void *ptr, size_t size);
+
+extern "C" void *
+malloc (size_t size)
+{
+  if (counting.load (std::memory_order_relaxed))
+    allocations++;
+  return __libc_malloc (size);
+}
+
+extern "C" void *
+calloc (size_t n, size_t size)
+{
+  if (counting.load (std::memory_order_relaxed))
+    allocations++;
+  return __libc_calloc (n, size);
+}
+
+extern "C" void *
+realloc (void *ptr, size_t size)
+{
+  if (counting.load (std::memory_order_relaxed))
+    allocations++;
+  return __libc_realloc (ptr, size);
+}
+#endif
+
+/* The state of a sweep, the tasks don't capture anything */
+static int fds[TEMP_FILES];
+static guint64 values[TEMP_FILES];
+static std::atomic<gsize> units_done(0);
+static xfce4::Ptr0<xfce4::Wakeup> wakeup;
+static bool tick_done;
+
+static void sweep_unit_done (gsize n);
+
+
+
+static void
+sweep_unit_done (gsize n)
+{
+  /* The file reads plus the single-thread task */
+  if (units_done.fetch_add (n) + n == TEMP_FILES + 1)
+  {
+    units_done = 0;
+    wakeup->trigger ();
+  }
+}
+
+
+
+int
+main ()
+{
+#if !ALLOC_COUNTING
+  fprintf (stderr, "malloc() can't be interposed in this build\n");
+  return EXIT_SKIP;
+#endif
+
+  gchar *dir = g_dir_make_tmp ("test-alloc-XXXXXX", NULL);
+  if (dir == NULL)
+    return EXIT_SKIP;
+  const std::string temp_dir = dir;
+  g_free (dir);
+
+  for (guint i = 0; i < TEMP_FILES; i++)
+  {
+    gchar *file = g_strdup_printf ("%s/%u", temp_dir.c_str(), i);
+    gchar *contents = g_strdup_printf ("%u\n", 800000 + 1000 * i);
+    g_file_set_contents (file, contents, -1, NULL);
+    fds[i] = open (file, O_RDONLY | O_CLOEXEC);
+    g_unlink (file);
+    g_free (contents);
+    g_free (file);
+    if (fds[i] < 0)
+    {
+      fprintf (stderr, "open: %s\n", g_strerror (errno));
+      return 1;
+    }
+  }
+  g_rmdir (temp_dir.c_str());
+
+  wakeup = xfce4::make<xfce4::Wakeup>([]() {
+    tick_done = true;
+  });
+
+  xfce4::LaunchConfig config;
+  config.start_if_busy = true;
+
+  for (guint tick = 0; tick < WARMUP + TICKS; tick++)
+  {
+    if (tick == WARMUP)
+    {
+      allocations = 0;
+      counting = true;
+    }
+
+    tick_done = false;
+    xfce4::parallelTaskQueue->start_range(config, TEMP_FILES, [](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++)
+      {
+        gchar buf[BUF_SIZE];
+        const ssize_t n = pread (fds[i], buf, BUF_SIZE - 1, 0);
+        buf[MAX (n, 0)] = '\0';
+        values[i] = g_ascii_strtoull (buf, NULL, 10);
+      }
+      sweep_unit_done (end - begin);
+    });
+    xfce4::singleThreadQueue->start(config, []() {
+      sweep_unit_done (1);
+    });
+
+    while (!tick_done)
+      g_main_context_iteration (NULL, TRUE);
+
+    for (guint i = 0; i < TEMP_FILES; i++)
+      if (values[i] != 800000 + 1000 * i)
+      {
+        fprintf (stderr, "file %u: read %" G_GUINT64_FORMAT "\n", i, values[i]);
+        return 1;
+      }
+  }
+  counting = false;
+  const gsize counted = allocations;
+
+  wakeup = nullptr;
+  for (int fd : fds)
+    close (fd);
+
+  printf ("%zu allocations in %u ticks\n", counted, TICKS);
+  return counted == 0 ? 0 : 1;
+}
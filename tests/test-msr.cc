@@ -0,0 +1,219 @@
+/*  xfce4-cpu-freq-plugin - panel plugin for cpu informations
+ *
+ *  Copyright (c) 2026 The Xfce development team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Runs the APERF/MPERF reader against a fake tree of msr devices:
+ * regular files base/N/msr with the registers stored at their offsets.
+ *
+ * The msr driver treats the file offset as the register number, so in a regular
+ * file the 8-byte registers MPERF (0xe7) and APERF (0xe8) overlap: MPERF is always
+ * APERF << 8, and a fake CPU runs at 1/256 of its TSC frequency.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "xfce4-cpufreq-linux-msr.h"
+
+#define MSR_IA32_TSC   0x10
+#define MSR_IA32_MPERF 0xe7
+#define MSR_IA32_APERF 0xe8
+
+/* The frequency of a fake CPU relative to its TSC frequency */
+#define FAKE_RATIO (1.0 / 256)
+
+#define NUM_CPUS 4
+
+/* Exit status that makes meson report a skipped test */
+#define EXIT_SKIP 77
+
+static std::string msr_file (const std::string &base, guint cpu);
+
+static void msr_write (const std::string &base, guint cpu, guint64 tsc, guint64 aperf);
+
+static bool check_freq (CpuFreqMsr *msr, guint cpu, gdouble expected_khz);
+
+
+
+static std::string
+msr_file (const std::string &base, guint cpu)
+{
+  gchar *dir = g_strdup_printf ("%s/%u", base.c_str(), cpu);
+  g_mkdir_with_parents (dir, 0700);
+  std::string file = std::string (dir) + "/msr";
+  g_free (dir);
+  return file;
+}
+
+
+
+static void
+msr_write (const std::string &base, guint cpu, guint64 tsc, guint64 aperf)
+{
+  const std::string file = msr_file (base, cpu);
+  const guint64 mperf = aperf << 8;
+  const guint8 top = 0;  /* the last byte of APERF, past the end of MPERF */
+  int fd = open (file.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0 ||
+      pwrite (fd, &tsc, sizeof (tsc), MSR_IA32_TSC) != sizeof (tsc) ||
+      pwrite (fd, &mperf, sizeof (mperf), MSR_IA32_MPERF) != sizeof (mperf) ||
+      pwrite (fd, &top, sizeof (top), MSR_IA32_APERF + sizeof (aperf) - 1) != sizeof (top))
+    g_error ("%s: %s", file.c_str(), g_strerror (errno));
+  close (fd);
+}
+
+
+
+/*
+ * The TSC frequency is measured against the monotonic clock of the test,
+ * so the result is only approximately known.
+ */
+static bool
+check_freq (CpuFreqMsr *msr, guint cpu, gdouble expected_khz)
+{
+  guint freq = 0;
+  if (!cpufreq_msr_read_freq (msr, cpu, &freq))
+  {
+    fprintf (stderr, "CPU %u: no frequency, expected %.0f kHz\n", cpu, expected_khz);
+    return false;
+  }
+  if (freq < 0.5 * expected_khz || freq > 1.5 * expected_khz)
+  {
+    fprintf (stderr, "CPU %u: %u kHz, expected about %.0f kHz\n", cpu, freq, expected_khz);
+    return false;
+  }
+  return true;
+}
+
+
+
+int
+main ()
+{
+#if defined(__i386__) || defined(__x86_64__)
+  gchar *dir = g_dir_make_tmp ("test-msr-XXXXXX", NULL);
+  if (dir == NULL)
+    return EXIT_SKIP;
+  const std::string base = dir;
+  g_free (dir);
+
+  int status = 0;
+  guint freq;
+
+  /* No devices at all: the msr module isn't loaded */
+  if (cpufreq_msr_new (base.c_str(), std::vector<bool> (NUM_CPUS)))
+  {
+    fprintf (stderr, "opened an empty msr tree\n");
+    status = 1;
+  }
+
+  /* A device without APERF/MPERF: the file ends before their offsets */
+  {
+    const std::string file = msr_file (base, 0);
+    guint64 tsc = 1;
+    if (!g_file_set_contents (file.c_str(), (const gchar*) &tsc, sizeof (tsc), NULL))
+      g_error ("%s", file.c_str());
+    if (cpufreq_msr_new (base.c_str(), std::vector<bool> (NUM_CPUS)))
+    {
+      fprintf (stderr, "opened an msr device without APERF/MPERF\n");
+      status = 1;
+    }
+    g_unlink (file.c_str());
+  }
+
+  /*
+   * CPU 0 is isolated and has no device, so the support has to be probed on CPU 1.
+   * CPU 3 is offline (has no device) until the second sample.
+   */
+  for (guint cpu = 1; cpu < NUM_CPUS - 1; cpu++)
+    msr_write (base, cpu, 0, 1000);
+
+  std::vector<bool> isolated (NUM_CPUS);
+  isolated[0] = true;
+  auto msr = cpufreq_msr_new (base.c_str(), isolated);
+  if (!msr)
+  {
+    fprintf (stderr, "the msr tree with an isolated CPU 0 wasn't opened\n");
+    return 1;
+  }
+
+  /* The first call only takes the initial sample */
+  for (guint cpu = 0; cpu < NUM_CPUS; cpu++)
+  {
+    if (cpufreq_msr_read_freq (msr.get(), cpu, &freq))
+    {
+      fprintf (stderr, "CPU %u: a frequency without a previous sample\n", cpu);
+      status = 1;
+    }
+  }
+
+  /* Advance the TSCs for 100 ms, so that CPU 1 runs at about 3 GHz and CPU 2 at about 1 GHz */
+  const gint64 start = g_get_monotonic_time ();
+  g_usleep (100 * 1000);
+  const gint64 elapsed = g_get_monotonic_time () - start;
+  const guint64 tsc = guint64 (3000 / FAKE_RATIO * elapsed);
+  msr_write (base, 1, tsc, 1000 + 1000000);
+  msr_write (base, 2, tsc / 3, 1000 + 1000000);
+  msr_write (base, 3, 0, 1000);
+
+  if (!check_freq (msr.get(), 1, 3000000) || !check_freq (msr.get(), 2, 1000000))
+    status = 1;
+
+  /* The counters must not go backwards */
+  msr_write (base, 1, tsc / 2, 1000);
+  if (cpufreq_msr_read_freq (msr.get(), 1, &freq))
+  {
+    fprintf (stderr, "CPU 1: a frequency from counters that went backwards\n");
+    status = 1;
+  }
+
+  /* A CPU that went offline fails, and its device is reopened once it is back */
+  g_unlink (msr_file (base, 3).c_str());
+  if (cpufreq_msr_read_freq (msr.get(), 3, &freq))
+  {
+    fprintf (stderr, "CPU 3: a frequency from a removed device\n");
+    status = 1;
+  }
+  msr_write (base, 3, 0, 1000);
+  if (cpufreq_msr_read_freq (msr.get(), 3, &freq))
+  {
+    fprintf (stderr, "CPU 3: a frequency without a previous sample after going online\n");
+    status = 1;
+  }
+
+  msr = nullptr;
+  for (guint cpu = 0; cpu < NUM_CPUS; cpu++)
+  {
+    const std::string file = msr_file (base, cpu);
+    g_unlink (file.c_str());
+    g_rmdir (file.substr (0, file.size() - strlen ("/msr")).c_str());
+  }
+  g_rmdir (base.c_str());
+  return status;
+#else
+  return EXIT_SKIP;
+#endif
+}
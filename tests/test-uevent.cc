@@ -0,0 +1,136 @@
+/*  xfce4-cpu-freq-plugin - panel plugin for cpu informations
+ *
+ *  Copyright (c) 2026 The Xfce development team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Feeds synthetic kernel uevent messages through a socketpair into
+ * cpufreq_uevent_new_from_fd() and checks which of them reach the handler.
+ */
+
+#include <errno.h>
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "xfce4-cpufreq-linux-uevent.h"
+
+struct Event
+{
+  CpuUeventAction action;
+  guint cpu;
+};
+
+static void uevent_send (int fd, const std::string &header, const std::vector<std::string> &fields);
+
+
+
+/*
+ * Sends "HEADER\0KEY=VALUE\0..." as a single datagram, the way the kernel formats it.
+ */
+static void
+uevent_send (int fd, const std::string &header, const std::vector<std::string> &fields)
+{
+  std::string msg = header;
+  msg.push_back ('\0');
+  for (const std::string &field : fields)
+  {
+    msg += field;
+    msg.push_back ('\0');
+  }
+  if (send (fd, msg.data(), msg.size(), 0) != gssize (msg.size()))
+    g_error ("send: %s", g_strerror (errno));
+}
+
+
+
+int
+main ()
+{
+  int fds[2];
+  if (socketpair (AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) != 0)
+  {
+    fprintf (stderr, "socketpair: %s\n", g_strerror (errno));
+    return 1;
+  }
+
+  std::vector<Event> events;
+  auto uevent = cpufreq_uevent_new_from_fd (fds[0], [&events](CpuUeventAction action, guint cpu) {
+    events.push_back (Event{action, cpu});
+  });
+
+  uevent_send (fds[1], "online@/devices/system/cpu/cpu3",
+               { "ACTION=online", "DEVPATH=/devices/system/cpu/cpu3", "SUBSYSTEM=cpu", "SEQNUM=1" });
+  uevent_send (fds[1], "offline@/devices/system/cpu/cpu12",
+               { "ACTION=offline", "DEVPATH=/devices/system/cpu/cpu12", "SUBSYSTEM=cpu", "SEQNUM=2" });
+  uevent_send (fds[1], "add@/devices/system/cpu/cpu255",
+               { "ACTION=add", "DEVPATH=/devices/system/cpu/cpu255", "SUBSYSTEM=cpu", "SEQNUM=3" });
+  uevent_send (fds[1], "remove@/devices/system/cpu/cpu255",
+               { "ACTION=remove", "DEVPATH=/devices/system/cpu/cpu255", "SUBSYSTEM=cpu", "SEQNUM=4" });
+
+  /* Ignored: other subsystems and devices, unknown actions and malformed paths */
+  uevent_send (fds[1], "add@/devices/virtual/net/lo",
+               { "ACTION=add", "DEVPATH=/devices/virtual/net/lo", "SUBSYSTEM=net", "SEQNUM=5" });
+  uevent_send (fds[1], "change@/devices/system/cpu/cpu1",
+               { "ACTION=change", "DEVPATH=/devices/system/cpu/cpu1", "SUBSYSTEM=cpu", "SEQNUM=6" });
+  uevent_send (fds[1], "add@/devices/system/cpu/cpufreq",
+               { "ACTION=add", "DEVPATH=/devices/system/cpu/cpufreq", "SUBSYSTEM=cpu", "SEQNUM=7" });
+  uevent_send (fds[1], "add@/devices/system/cpu/cpu4/cache",
+               { "ACTION=add", "DEVPATH=/devices/system/cpu/cpu4/cache", "SUBSYSTEM=cpu", "SEQNUM=8" });
+  uevent_send (fds[1], "online@/devices/system/cpu/cpu5", { "ACTION=online", "SUBSYSTEM=cpu" });
+
+  /* The last message marks the end of the input */
+  uevent_send (fds[1], "offline@/devices/system/cpu/cpu0",
+               { "ACTION=offline", "DEVPATH=/devices/system/cpu/cpu0", "SUBSYSTEM=cpu", "SEQNUM=9" });
+
+  const gint64 deadline = g_get_monotonic_time () + 5 * G_USEC_PER_SEC;
+  while ((events.empty() || events.back().cpu != 0) && g_get_monotonic_time () < deadline)
+    if (!g_main_context_iteration (NULL, FALSE))
+      g_usleep (1000);
+
+  static const Event expected[] = {
+    { CPU_UEVENT_ONLINE, 3 },
+    { CPU_UEVENT_OFFLINE, 12 },
+    { CPU_UEVENT_ADD, 255 },
+    { CPU_UEVENT_REMOVE, 255 },
+    { CPU_UEVENT_OFFLINE, 0 },
+  };
+
+  int status = 0;
+  if (events.size() != G_N_ELEMENTS (expected))
+  {
+    fprintf (stderr, "received %zu events, expected %zu\n", events.size(), gsize (G_N_ELEMENTS (expected)));
+    status = 1;
+  }
+  for (gsize i = 0; i < MIN (events.size(), G_N_ELEMENTS (expected)); i++)
+  {
+    if (events[i].action != expected[i].action || events[i].cpu != expected[i].cpu)
+    {
+      fprintf (stderr, "event %zu: action %d cpu %u, expected action %d cpu %u\n",
+               i, events[i].action, events[i].cpu, expected[i].action, expected[i].cpu);
+      status = 1;
+    }
+  }
+
+  uevent = nullptr;
+  close (fds[1]);
+  return status;
+}
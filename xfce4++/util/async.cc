@@ -19,23 +19,43 @@
  */
 
 #include "async.h"
+#include "gtk.h"
 
 #include <algorithm>
 #include <condition_variable>
 #include <list>
 #include <mutex>
 #include <thread>
-#include <unistd.h>
+#include <vector>
 
 namespace xfce4 {
 
 TaskQueue::~TaskQueue() {}
 
+void TaskQueue::start_range(const LaunchConfig config, size_t count, const RangeTask &task) {
+    start(config, [count, task]() {
+        task(0, count);
+    });
+}
+
+/*
+ * The number of tasks that the queues preallocate nodes for. A task that finished may
+ * still be waiting for its node to be recycled while the next one starts.
+ */
+static const size_t SPARE_TASKS = 4;
+
 struct SingleThreadQueue final : TaskQueue {
+    struct Entry {
+        Task task;
+        Task done;
+    };
+
     struct Data {
         std::condition_variable cond_var;
         std::mutex mutex;
-        std::list<Task> queue;
+        std::list<Entry> queue;
+        std::list<Entry> spare = std::list<Entry>(SPARE_TASKS);  /* Finished entries, reused so that start() doesn't allocate memory */
+        size_t pending = 0;  /* Number of queued or running tasks */
         bool stop = false;
     };
     Ptr<Data> data = make<Data>();
@@ -46,71 +66,210 @@ struct SingleThreadQueue final : TaskQueue {
     void start(const LaunchConfig config, const Task &task) override;
 };
 
+struct ParallelTaskQueue final : TaskQueue {
+    /* The upper bound on the number of threads in the pool */
+    static const unsigned MAX_THREADS = 8;
+
+    /* A task, or a range task, whose chunks are in the queue or running */
+    struct Range {
+        Task task;              /* Set by start() */
+        RangeTask range_task;   /* Set by start_range() */
+        size_t remaining = 0;   /* Number of chunks that didn't finish yet */
+        Task done;
+    };
+
+    struct Item {
+        std::list<Range>::iterator range;
+        size_t begin, end;
+    };
+
+    struct Data {
+        std::condition_variable cond_var;
+        std::mutex mutex;
+        std::list<Item> queue;
+        std::list<Range> ranges;
+        size_t pending = 0;  /* Number of queued or running tasks */
+        unsigned max_chunks = 1;
+        bool stop = false;
+
+        /* Finished items and ranges, reused so that starting a task doesn't allocate memory */
+        std::list<Item> spare_items = std::list<Item>(SPARE_TASKS * MAX_THREADS);
+        std::list<Range> spare_ranges = std::list<Range>(SPARE_TASKS);
+
+        /* Must be called with 'mutex' locked, returns the number of chunks */
+        size_t enqueue(size_t count, const Task &task, const RangeTask &range_task, const Task &done);
+    };
+    Ptr<Data> data = make<Data>();
+    std::vector<std::thread*> threads;
+    const unsigned max_threads;
+
+    ParallelTaskQueue();
+    ~ParallelTaskQueue();
+
+    void start(const LaunchConfig config, const Task &task) override;
+    void start_range(const LaunchConfig config, size_t count, const RangeTask &task) override;
+
+private:
+    void spawn_threads(size_t count);
+};
+
 const Ptr<TaskQueue> singleThreadQueue = make<SingleThreadQueue>();
+const Ptr<TaskQueue> parallelTaskQueue = make<ParallelTaskQueue>();
 
 SingleThreadQueue::~SingleThreadQueue() {
-    data->mutex.lock();
     if(thread) {
-        data->stop = true;
-        data->mutex.unlock();
+        {
+            std::lock_guard<std::mutex> lock(data->mutex);
+            data->stop = true;
+        }
         data->cond_var.notify_one();
         thread->join();
         delete thread;
     }
-    else {
-        data->mutex.unlock();
-    }
 }
 
 void SingleThreadQueue::start(const LaunchConfig config, const Task &task) {
-    // Previously queued tasks
-    while(true) {
-        data->mutex.lock();
-        if(!data->queue.empty()) {
-            data->mutex.unlock();
-            if(config.start_if_busy) {
-                // Wait for the thread to empty the queue
-                usleep(100*1000);
-            }
-            else {
-                // Discard the task
-                return;
-            }
-        }
-        else {
-            data->mutex.unlock();
-            break;
-        }
+    std::unique_lock<std::mutex> guard(data->mutex);
+    if(data->pending != 0 && !config.start_if_busy) {
+        // Discard the task
+        return;
     }
 
-    // Add task to the queue
-    data->mutex.lock();
-    data->queue.push_back(task);
-    data->mutex.unlock();
-    data->cond_var.notify_one();
+    if(data->spare.empty())
+        data->spare.emplace_back();
+    data->queue.splice(data->queue.end(), data->spare, data->spare.begin());
+    data->queue.back().task = task;
+    data->queue.back().done = config.done;
+    data->pending++;
 
-    data->mutex.lock();
     if(!thread) {
         thread = new std::thread([data = this->data]() {
+            std::unique_lock<std::mutex> lock(data->mutex);
             while(true) {
-                std::unique_lock<std::mutex> lock(data->mutex);
-                data->cond_var.wait(lock, [data]() {
+                data->cond_var.wait(lock, [&data]() {
                     return !data->queue.empty() || data->stop;
                 });
-                if(data->stop) {
-                    lock.unlock();
+                if(data->stop)
                     break;
-                }
-                else {
-                    auto f = std::move(data->queue.front());
-                    data->queue.pop_front();
-                    lock.unlock();
-                    f();
-                }
+
+                // The entry stays in the queue while it runs, start() only appends
+                Entry &next = data->queue.front();
+                lock.unlock();
+                next.task();
+                lock.lock();
+                data->pending--;
+
+                if(next.done)
+                    invoke_later(next.done);
+                next = Entry();
+                data->spare.splice(data->spare.end(), data->queue, data->queue.begin());
             }
         });
     }
+
+    guard.unlock();
+    data->cond_var.notify_one();
+}
+
+ParallelTaskQueue::ParallelTaskQueue() :
+    max_threads(std::max(1u, std::min(std::thread::hardware_concurrency(), unsigned(MAX_THREADS))))
+{
+    data->max_chunks = max_threads;
+}
+
+ParallelTaskQueue::~ParallelTaskQueue() {
+    data->mutex.lock();
+    data->stop = true;
     data->mutex.unlock();
+    data->cond_var.notify_all();
+    for(std::thread *thread : threads) {
+        thread->join();
+        delete thread;
+    }
+}
+
+void ParallelTaskQueue::start(const LaunchConfig config, const Task &task) {
+    std::unique_lock<std::mutex> lock(data->mutex);
+    if(data->pending != 0 && !config.start_if_busy) {
+        // Discard the task
+        return;
+    }
+
+    const size_t num_chunks = data->enqueue(1, task, RangeTask(), config.done);
+    spawn_threads(num_chunks);
+    lock.unlock();
+    data->cond_var.notify_all();
+}
+
+void ParallelTaskQueue::start_range(const LaunchConfig config, size_t count, const RangeTask &task) {
+    if(count == 0)
+        return;
+
+    std::unique_lock<std::mutex> lock(data->mutex);
+    if(data->pending != 0 && !config.start_if_busy) {
+        // Discard the task
+        return;
+    }
+
+    const size_t num_chunks = data->enqueue(count, Task(), task, config.done);
+    spawn_threads(num_chunks);
+    lock.unlock();
+    data->cond_var.notify_all();
+}
+
+size_t ParallelTaskQueue::Data::enqueue(size_t count, const Task &task, const RangeTask &range_task, const Task &done) {
+    const size_t num_chunks = std::min(count, size_t(max_chunks));
+
+    if(spare_ranges.empty())
+        spare_ranges.emplace_back();
+    ranges.splice(ranges.end(), spare_ranges, spare_ranges.begin());
+    const auto range = std::prev(ranges.end());
+    range->task = task;
+    range->range_task = range_task;
+    range->remaining = num_chunks;
+    range->done = done;
+
+    for(size_t i = 0; i < num_chunks; i++) {
+        if(spare_items.empty())
+            spare_items.emplace_back();
+        queue.splice(queue.end(), spare_items, spare_items.begin());
+        queue.back() = Item{range, count * i / num_chunks, count * (i + 1) / num_chunks};
+    }
+    pending += num_chunks;
+    return num_chunks;
+}
+
+/* Must be called with data->mutex locked */
+void ParallelTaskQueue::spawn_threads(size_t count) {
+    while(threads.size() < count && threads.size() < max_threads) {
+        threads.push_back(new std::thread([data = this->data]() {
+            std::unique_lock<std::mutex> lock(data->mutex);
+            while(true) {
+                data->cond_var.wait(lock, [&data]() {
+                    return !data->queue.empty() || data->stop;
+                });
+                if(data->stop)
+                    break;
+
+                const Item item = data->queue.front();
+                data->spare_items.splice(data->spare_items.end(), data->queue, data->queue.begin());
+                lock.unlock();
+                if(item.range->task)
+                    item.range->task();
+                else
+                    item.range->range_task(item.begin, item.end);
+                lock.lock();
+                data->pending--;
+
+                if(--item.range->remaining == 0) {
+                    if(item.range->done)
+                        invoke_later(item.range->done);
+                    *item.range = Range();
+                    data->spare_ranges.splice(data->spare_ranges.end(), data->ranges, item.range);
+                }
+            }
+        }));
+    }
 }
 
 } /* namespace xfce4 */
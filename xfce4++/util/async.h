@@ -30,25 +30,40 @@ struct LaunchConfig {
     /*
      * Start the task even if the previously started task didn't finish yet?
      *
-     * If the OS thread is busy and start_if_busy==true, then the argument 'task'
+     * If the queue is busy and start_if_busy==false, then the argument 'task'
      * passed to 'start(config, task)' is discarded and 'start(config, task)' returns
      * immediately without calling/evaluating 'task'.
      */
     bool start_if_busy = true;
+
+    /* If not null, called in the main thread after the task finished */
+    std::function<void()> done;
 };
 
 struct TaskQueue {
     typedef std::function<void()> Task;
+    typedef std::function<void(size_t begin, size_t end)> RangeTask;
 
     virtual ~TaskQueue();
 
     /*
-     * Launches the specified task in this queue.
+     * Launches the specified task in this queue. Never blocks the caller.
      *
      * In case the current thread is the GUI thread, then the task
      * might be able to run without interfering with the GUI thread.
      */
     virtual void start(LaunchConfig config, const Task &task) = 0;
+
+    /*
+     * Launches a task that processes the index range [0, count).
+     *
+     * The queue may split the range into disjoint chunks [begin, end)
+     * and call 'task' for multiple chunks concurrently. All chunks together
+     * count as a single task with respect to LaunchConfig::start_if_busy.
+     *
+     * The default implementation calls 'task(0, count)' from a single task.
+     */
+    virtual void start_range(LaunchConfig config, size_t count, const RangeTask &task);
 };
 
 /*
@@ -57,6 +72,12 @@ struct TaskQueue {
  */
 extern const Ptr<TaskQueue> singleThreadQueue;
 
+/*
+ * A queue that runs tasks in a pool of OS threads that are different from the main GUI thread.
+ * start_range() splits the range into chunks which are processed by the threads concurrently.
+ */
+extern const Ptr<TaskQueue> parallelTaskQueue;
+
 } /* namespace xfce4 */
 
 #endif /* _XFCE4PP_UTIL_ASYNC_H_ */
@@ -100,6 +100,11 @@ void connect(GtkToggleButton *widget, const char *signal, const std::function<vo
  * Connection functions, with links to associated GTK documentation.
  */
 
+/* http://docs.gtk.org/gtk3/signal.Entry.activate.html */
+void connect_activate(GtkEntry *widget, const std::function<ActivateHandler_Entry> &handler) {
+    _connect<void>(widget, "activate", handler);
+}
+
 void connect_after_draw(GtkWidget *widget, const std::function<DrawHandler1> &handler) {
     connect_after_draw(widget, [handler](GtkWidget*, cairo_t *cr) {
         return handler(cr);
@@ -141,6 +146,11 @@ void connect_color_set(GtkColorButton *widget, const std::function<ColorSetHandl
     _connect<void>(widget, "color-set", handler);
 }
 
+/* http://docs.gtk.org/gtk3/signal.Widget.configure-event.html */
+void connect_configure(GtkWidget *widget, const std::function<ConfigureHandler> &handler) {
+    _connect<gboolean>(widget, "configure-event", handler);
+}
+
 /* http://docs.gtk.org/gtk3/signal.Widget.destroy.html */
 void connect_destroy(GtkWidget *widget, const std::function<DestroyHandler> &handler) {
     _connect<void>(widget, "destroy", handler);
@@ -170,6 +180,11 @@ void connect_enter_notify(GtkWidget *widget, const std::function<EnterNotifyHand
     _connect<gboolean>(widget, "enter-notify-event", handler);
 }
 
+/* http://docs.gtk.org/gtk3/signal.Widget.focus-out-event.html */
+void connect_focus_out(GtkWidget *widget, const std::function<FocusHandler> &handler) {
+    _connect<gboolean>(widget, "focus-out-event", handler);
+}
+
 /* http://docs.gtk.org/gtk3/signal.FontButton.font-set.html */
  void connect_font_set(GtkFontButton *widget, const std::function<FontSetHandler> &handler) {
     _connect<void>(widget, "font-set", handler);
@@ -184,6 +199,11 @@ void connect_leave_notify(GtkWidget *widget, const std::function<LeaveNotifyHand
     _connect<gboolean>(widget, "leave-notify-event", handler);
 }
 
+/* http://docs.gtk.org/gtk3/signal.Widget.map.html */
+void connect_map(GtkWidget *widget, const std::function<MapHandler> &handler) {
+    _connect<void>(widget, "map", handler);
+}
+
 /* http://docs.gtk.org/gtk3/signal.Widget.query-tooltip.html */
 void connect_query_tooltip(GtkWidget *widget, const std::function<TooltipHandler> &handler) {
     _connect<gboolean>(widget, "query-tooltip", handler);
@@ -204,6 +224,11 @@ void connect_toggled(GtkToggleButton *widget, const std::function<ToggledHandler
     _connect<void>(widget, "toggled", handler);
 }
 
+/* http://docs.gtk.org/gtk3/signal.Widget.unmap.html */
+void connect_unmap(GtkWidget *widget, const std::function<MapHandler> &handler) {
+    _connect<void>(widget, "unmap", handler);
+}
+
 /* http://docs.gtk.org/gtk3/signal.Adjustment.value-changed.html */
 void connect_value_changed(GtkAdjustment *object, const std::function<ValueChangedHandler_Adjustment> &handler) {
     _connect<void>(object, "value_changed", handler);
@@ -293,6 +318,36 @@ guint timeout_add(guint interval_ms, const std::function<TimeoutHandler> &handle
 
 
 
+Wakeup::Wakeup(const std::function<void()> &_handler) : handler(_handler) {
+    static GSourceFuncs funcs = { NULL, NULL, dispatch, NULL, NULL, NULL };
+    source = g_source_new(&funcs, sizeof(GSource));
+    g_source_set_callback(source, call, this, NULL);
+    g_source_attach(source, NULL);
+}
+
+Wakeup::~Wakeup() {
+    g_source_destroy(source);
+    g_source_unref(source);
+}
+
+/* http://docs.gtk.org/glib/method.Source.set_ready_time.html */
+void Wakeup::trigger() {
+    g_source_set_ready_time(source, 0);
+}
+
+gboolean Wakeup::dispatch(GSource *source, GSourceFunc callback, gpointer data) {
+    /* Disarm before calling the handler, so that a trigger from the handler isn't lost */
+    g_source_set_ready_time(source, -1);
+    return callback(data);
+}
+
+gboolean Wakeup::call(gpointer data) {
+    ((Wakeup*)data)->handler();
+    return G_SOURCE_CONTINUE;
+}
+
+
+
 void RGBA::clamp() {
     R = (R >= 0 ? R : 0);
     G = (G >= 0 ? G : 0);
@@ -86,19 +86,23 @@ extern const Propagation     PROPAGATE, STOP;
 extern const TimeoutResponse TIMEOUT_AGAIN, TIMEOUT_REMOVE;
 extern const TooltipTime     LATER, NOW; /* If in doubt, use NOW */
 
+typedef void        ActivateHandler_Entry            (GtkEntry *widget);
 typedef Propagation ButtonHandler                    (GtkWidget *widget, GdkEventButton *event);
 typedef void        ChangedHandler_ComboBox          (GtkComboBox *widget);
 typedef Propagation ChangeValueHandler_Range         (GtkRange *widget, GtkScrollType *scroll, gdouble value);
 typedef void        CheckResizeHandler               (GtkContainer *widget);
 typedef void        ClickHandler                     (GtkButton *widget);
 typedef void        ColorSetHandler                  (GtkColorButton *widget);
+typedef Propagation ConfigureHandler                 (GtkWidget *widget, GdkEventConfigure *event);
 typedef void        DestroyHandler                   (GtkWidget *widget);
 typedef Propagation DrawHandler1                     (cairo_t *cr);
 typedef Propagation DrawHandler2                     (GtkWidget *widget, cairo_t *cr);
 typedef void        EditedHandler                    (GtkCellRendererText *object, gchar *path, gchar *new_text);
 typedef Propagation EnterNotifyHandler               (GtkWidget *widget, GdkEventCrossing *event);
+typedef Propagation FocusHandler                     (GtkWidget *widget, GdkEventFocus *event);
 typedef void        FontSetHandler                   (GtkFontButton *widget);
 typedef Propagation LeaveNotifyHandler               (GtkWidget *widget, GdkEventCrossing *event);
+typedef void        MapHandler                       (GtkWidget *widget);
 typedef void        ResponseHandler                  (GtkDialog *widget, gint response);
 typedef void        ToggledHandler_CellRendererToggle(GtkCellRendererToggle *object, gchar *path);
 typedef void        ToggledHandler_ToggleButton      (GtkToggleButton *widget);
@@ -106,6 +110,7 @@ typedef TooltipTime TooltipHandler                   (GtkWidget *widget, gint x,
 typedef void        ValueChangedHandler_Adjustment   (GtkAdjustment *object);
 typedef void        ValueChangedHandler_SpinButton   (GtkSpinButton *widget);
 
+void connect_activate     (GtkEntry              *widget, const std::function<ActivateHandler_Entry>             &handler);
 void connect_after_draw   (GtkWidget             *widget, const std::function<DrawHandler1>                      &handler);
 void connect_after_draw   (GtkWidget             *widget, const std::function<DrawHandler2>                      &handler);
 void connect_button_press (GtkWidget             *widget, const std::function<ButtonHandler>                     &handler);
@@ -114,17 +119,21 @@ void connect_change_value (GtkRange              *widget, const std::function<Ch
 void connect_check_resize (GtkContainer          *widget, const std::function<CheckResizeHandler>                &handler);
 void connect_clicked      (GtkButton             *widget, const std::function<ClickHandler>                      &handler);
 void connect_color_set    (GtkColorButton        *widget, const std::function<ColorSetHandler>                   &handler);
+void connect_configure    (GtkWidget             *widget, const std::function<ConfigureHandler>                  &handler);
 void connect_destroy      (GtkWidget             *widget, const std::function<DestroyHandler>                    &handler);
 void connect_draw         (GtkWidget             *widget, const std::function<DrawHandler1>                      &handler);
 void connect_draw         (GtkWidget             *widget, const std::function<DrawHandler2>                      &handler);
 void connect_edited       (GtkCellRendererText   *object, const std::function<EditedHandler>                     &handler);
 void connect_enter_notify (GtkWidget             *widget, const std::function<EnterNotifyHandler>                &handler);
+void connect_focus_out    (GtkWidget             *widget, const std::function<FocusHandler>                      &handler);
 void connect_font_set     (GtkFontButton         *widget, const std::function<FontSetHandler>                    &handler);
 void connect_leave_notify (GtkWidget             *widget, const std::function<LeaveNotifyHandler>                &handler);
+void connect_map          (GtkWidget             *widget, const std::function<MapHandler>                        &handler);
 void connect_query_tooltip(GtkWidget             *widget, const std::function<TooltipHandler>                    &handler);
 void connect_response     (GtkDialog             *widget, const std::function<ResponseHandler>                   &handler);
 void connect_toggled      (GtkCellRendererToggle *object, const std::function<ToggledHandler_CellRendererToggle> &handler);
 void connect_toggled      (GtkToggleButton       *widget, const std::function<ToggledHandler_ToggleButton>       &handler);
+void connect_unmap        (GtkWidget             *widget, const std::function<MapHandler>                        &handler);
 void connect_value_changed(GtkAdjustment         *object, const std::function<ValueChangedHandler_Adjustment>    &handler);
 void connect_value_changed(GtkSpinButton         *widget, const std::function<ValueChangedHandler_SpinButton>    &handler);
 
@@ -145,6 +154,29 @@ typedef TimeoutResponse TimeoutHandler();
 
 guint timeout_add(guint interval_ms, const std::function<TimeoutHandler> &handler);
 
+/*
+ * A source in the default main context that calls the handler in the main thread after trigger().
+ * Unlike invoke_later(), trigger() doesn't allocate memory, so it suits work that is handed over
+ * to the main thread over and over again. trigger() can be called from any thread.
+ * Triggers that arrive before the handler runs result in a single call.
+ */
+struct Wakeup {
+    explicit Wakeup(const std::function<void()> &handler);
+    ~Wakeup();
+
+    Wakeup(const Wakeup&) = delete;
+    Wakeup& operator=(const Wakeup&) = delete;
+
+    void trigger();
+
+private:
+    GSource *source;
+    const std::function<void()> handler;
+
+    static gboolean dispatch(GSource *source, GSourceFunc callback, gpointer data);
+    static gboolean call(gpointer data);
+};
+
 
 
 /*